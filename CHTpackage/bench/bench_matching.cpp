@@ -0,0 +1,390 @@
+// Standalone benchmarks of the matching engines, without R.
+//
+// Each run times the three phases of an R call separately:
+//   convert  names / ids / blood types -> engine arrays, as the Rcpp glue
+//            does (interning, rank tables, CSR graph);
+//   solve    the engine alone;
+//   output   engine result -> named pairs, as returned to R.
+// and prints one JSON object per line, so results can be appended to a file
+// and compared across versions.
+//
+// Algorithms: gs (gale_shapley_cpp), bucket (best_gs_bucket_cpp), hk
+// (hopcroft_karp_cpp). Instance families:
+//   gs, bucket  uniform     independent random lists
+//               correlated  lists sorted by a shared quality plus noise
+//               master      every man has the same list: n (n + 1) / 2
+//                           proposals, the Theta(n^2) worst case
+//   hk          blood       ABO/Rh types at population frequencies (dense)
+//               sparse      random graph of degree 8, given as id lists
+//               panel       64-antigen panel, few compatible pairs (sparse)
+//
+// usage: bench_matching [--algo gs|bucket|hk|all] [--family NAME|all]
+//                       [--n N] [--reps R] [--threads T] [--seed S]
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <numeric>
+#include <random>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "antigen_graph.h"
+#include "bipartite_matching.h"
+#include "gale_shapley_engine.h"
+#include "gs_bucket_engine.h"
+#include "gs_parallel_engine.h"
+#include "parallel_matching_engine.h"
+#include "worker_pool.h"
+
+#ifndef CHT_VERSION
+#define CHT_VERSION "unknown"
+#endif
+
+namespace {
+
+struct Options {
+  std::string algo = "all";
+  std::string family = "all";
+  int n = 1000;
+  int reps = 3;
+  int threads = 1;
+  unsigned seed = 42;
+};
+
+struct Timing {
+  double convert = 0, solve = 0, output = 0;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+double since(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// Stable marriage instance as R would hand it over: names and lists of names
+struct PrefInstance {
+  std::vector<std::string> men_names, women_names;
+  std::vector<std::vector<std::string>> men_prefs, women_prefs;
+};
+
+PrefInstance make_pref_instance(const std::string& family, int n, std::mt19937_64& rng) {
+  PrefInstance inst;
+  for (int i = 0; i < n; i++) {
+    inst.men_names.push_back("M" + std::to_string(i + 1));
+    inst.women_names.push_back("W" + std::to_string(i + 1));
+  }
+
+  std::vector<double> men_quality(n), women_quality(n);
+  std::normal_distribution<double> gauss(0.0, 1.0);
+  for (int i = 0; i < n; i++) {
+    men_quality[i] = gauss(rng);
+    women_quality[i] = gauss(rng);
+  }
+  std::vector<int> master(n);
+  std::iota(master.begin(), master.end(), 0);
+  std::shuffle(master.begin(), master.end(), rng);
+
+  auto list = [&](const std::vector<double>& quality, bool men_side) {
+    std::vector<int> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    if (family == "uniform" || (family == "master" && !men_side)) {
+      std::shuffle(order.begin(), order.end(), rng);
+    } else if (family == "master") {
+      order = master;
+    } else {
+      std::vector<double> score(n);
+      for (int j = 0; j < n; j++) score[j] = quality[j] + 0.5 * gauss(rng);
+      std::sort(order.begin(), order.end(), [&](int a, int b) { return score[a] > score[b]; });
+    }
+    return order;
+  };
+
+  for (int i = 0; i < n; i++) {
+    std::vector<std::string> prefs;
+    for (int w : list(women_quality, true)) prefs.push_back(inst.women_names[w]);
+    inst.men_prefs.push_back(std::move(prefs));
+  }
+  for (int i = 0; i < n; i++) {
+    std::vector<std::string> prefs;
+    for (int m : list(men_quality, false)) prefs.push_back(inst.men_names[m]);
+    inst.women_prefs.push_back(std::move(prefs));
+  }
+  return inst;
+}
+
+std::unordered_map<std::string_view, int> intern(const std::vector<std::string>& names) {
+  std::unordered_map<std::string_view, int> index;
+  index.reserve(names.size());
+  for (int i = 0; i < (int)names.size(); i++) index.emplace(names[i], i);
+  return index;
+}
+
+// gale_shapley_cpp: interning, concatenated lists, rank table; the output is
+// sorted by woman
+Timing run_gs(const PrefInstance& in, long long& proposals, long long& result) {
+  Timing t;
+  auto start = Clock::now();
+  const int n = in.men_names.size();
+  auto men_index = intern(in.men_names);
+  auto women_index = intern(in.women_names);
+  GSInstance inst;
+  inst.n_men = n;
+  inst.n_women = n;
+  inst.pref_start.resize(n + 1);
+  inst.pref_start[0] = 0;
+  for (int i = 0; i < n; i++) {
+    inst.pref_start[i + 1] = inst.pref_start[i] + in.men_prefs[i].size();
+    for (const std::string& w : in.men_prefs[i]) inst.pref_list.push_back(women_index.at(w));
+  }
+  inst.rank.assign((std::size_t)n * n, n);
+  for (int i = 0; i < n; i++) {
+    int* rank = inst.rank.data() + (std::size_t)i * n;
+    for (int j = 0; j < (int)in.women_prefs[i].size(); j++) rank[men_index.at(in.women_prefs[i][j])] = j;
+  }
+  t.convert = since(start);
+
+  start = Clock::now();
+  std::vector<int> engaged;
+  GSScratch scratch;
+  gale_shapley_solve(inst, engaged, scratch);
+  t.solve = since(start);
+  // The classic engine does not count proposals: rebuild the count from
+  // how far each man went down his list
+  proposals = 0;
+  for (int i = 0; i < n; i++) proposals += scratch.next[i] - inst.pref_start[i];
+
+  start = Clock::now();
+  std::vector<int> order;
+  for (int w = 0; w < n; w++) {
+    if (engaged[w] != -1) order.push_back(w);
+  }
+  std::sort(order.begin(), order.end(),
+            [&](int a, int b) { return in.women_names[a] < in.women_names[b]; });
+  std::vector<std::pair<std::string, std::string>> pairs;
+  pairs.reserve(order.size());
+  for (int w : order) pairs.emplace_back(in.men_names[engaged[w]], in.women_names[w]);
+  t.output = since(start);
+  result = pairs.size();
+  return t;
+}
+
+// best_gs_bucket_cpp: 16- or 32-bit preference store; the output follows
+// the men
+Timing run_bucket(const PrefInstance& in, int threads, long long& proposals, long long& result) {
+  Timing t;
+  const int n = in.men_names.size();
+  std::vector<int> matching;
+  dispatch_index_width(n, [&](auto index_type) {
+    using Index = decltype(index_type);
+    auto start = Clock::now();
+    PreferenceStore<Index> prefs;
+    prefs.reset(n);
+    auto women_index = intern(in.women_names);
+    auto men_index = intern(in.men_names);
+    for (int h = 0; h < n; h++) {
+      Index* row = prefs.men_pref(h);
+      for (int j = 0; j < n; j++) row[j] = (Index)women_index.at(in.men_prefs[h][j]);
+    }
+    for (int f = 0; f < n; f++) {
+      Index* rank = prefs.women_rank(f);
+      for (int pos = 0; pos < n; pos++) rank[men_index.at(in.women_prefs[f][pos])] = (Index)pos;
+    }
+    t.convert = since(start);
+
+    start = Clock::now();
+    if (threads > 1) {
+      WorkerPool pool(threads);
+      proposals = gs_parallel_solve(prefs, matching, pool);
+    } else {
+      proposals = gs_bucket_solve(prefs, matching);
+    }
+    t.solve = since(start);
+  });
+
+  auto start = Clock::now();
+  std::vector<std::pair<std::string, std::string>> pairs;
+  pairs.reserve(n);
+  for (int h = 0; h < n; h++) pairs.emplace_back(in.men_names[h], in.women_names[matching[h]]);
+  t.output = since(start);
+  result = pairs.size();
+  return t;
+}
+
+// Donor / receiver market in the form each entry point receives it
+struct MarketInstance {
+  std::vector<int> donors, receivers;             // ids
+  std::vector<std::string> blood_type;            // per id - 1 (blood)
+  std::vector<std::vector<int>> adjacency;        // receiver ids per donor (sparse)
+  std::vector<uint64_t> antigens, antibodies;     // one word per agent (panel)
+};
+
+const char* const blood_types[8] = {"A+", "A-", "B+", "B-", "AB+", "AB-", "O+", "O-"};
+
+MarketInstance make_market(const std::string& family, int n, std::mt19937_64& rng) {
+  MarketInstance m;
+  for (int i = 0; i < n; i++) {
+    m.donors.push_back(i + 1);
+    m.receivers.push_back(n + i + 1);
+  }
+  if (family == "blood") {
+    std::discrete_distribution<int> type({0.34, 0.06, 0.10, 0.02, 0.04, 0.01, 0.38, 0.05});
+    for (int i = 0; i < 2 * n; i++) m.blood_type.push_back(blood_types[type(rng)]);
+  } else if (family == "sparse") {
+    m.adjacency.resize(n);
+    for (int i = 0; i < n; i++) {
+      for (int k = 0; k < 8; k++) m.adjacency[i].push_back(n + 1 + (int)(rng() % n));
+    }
+  } else {
+    // Donors carry 4 of 64 antigens; receivers have antibodies against
+    // about 3 in 4 of them
+    for (int i = 0; i < n; i++) {
+      uint64_t a = 0;
+      for (int k = 0; k < 4; k++) a |= uint64_t(1) << (rng() % 64);
+      m.antigens.push_back(a);
+      m.antibodies.push_back(rng() | rng());
+    }
+  }
+  return m;
+}
+
+// hopcroft_karp_cpp and friends: graph building, engine, then one partner
+// id and one string key per agent as in the list output
+Timing run_hk(const std::string& family, const MarketInstance& in, int threads, long long& edges,
+              long long& result) {
+  Timing t;
+  const int n = in.donors.size();
+  WorkerPool pool(threads);
+  auto start = Clock::now();
+  BipartiteGraph graph;
+  if (family == "blood") {
+    std::vector<char> compatible(64);
+    const int antigens[8] = {1 | 4, 1, 2 | 4, 2, 1 | 2 | 4, 1 | 2, 4, 0};  // A, B, D bits
+    for (int d = 0; d < 8; d++) {
+      for (int r = 0; r < 8; r++) compatible[d * 8 + r] = (antigens[d] & ~antigens[r]) == 0;
+    }
+    auto classes = [&](const std::vector<int>& ids) {
+      std::vector<int> cls(ids.size(), -1);
+      for (std::size_t i = 0; i < ids.size(); i++) {
+        const std::string& type = in.blood_type[ids[i] - 1];
+        for (int k = 0; k < 8; k++) {
+          if (type == blood_types[k]) cls[i] = k;
+        }
+      }
+      return cls;
+    };
+    build_class_graph(8, compatible, classes(in.donors), classes(in.receivers), graph);
+  } else if (family == "sparse") {
+    std::unordered_map<int, int> receiver_index;
+    for (int j = 0; j < n; j++) receiver_index.emplace(in.receivers[j], j);
+    graph.n_left = n;
+    graph.n_right = n;
+    graph.start.assign(n + 1, 0);
+    for (int i = 0; i < n; i++) {
+      for (int id : in.adjacency[i]) graph.adj.push_back(receiver_index.at(id));
+      graph.start[i + 1] = graph.adj.size();
+    }
+  } else {
+    build_antigen_graph(in.antigens, in.antibodies, 1, pool, graph);
+  }
+  t.convert = since(start);
+  edges = graph.adj.size();
+
+  start = Clock::now();
+  std::vector<int> match_donor(n, -1), match_receiver(n, -1);
+  if (threads > 1) {
+    result = parallel_hopcroft_karp(graph, match_donor, match_receiver, pool);
+  } else {
+    HopcroftKarp engine;
+    result = engine.solve(graph, match_donor, match_receiver);
+  }
+  t.solve = since(start);
+
+  start = Clock::now();
+  std::vector<std::string> keys(n);
+  std::vector<int> partner(n);
+  for (int i = 0; i < n; i++) {
+    keys[i] = std::to_string(in.donors[i]);
+    partner[i] = match_donor[i] == -1 ? -1 : in.receivers[match_donor[i]];
+  }
+  t.output = since(start);
+  return t;
+}
+
+void emit(const Options& opt, const std::string& algo, const std::string& family, int rep,
+          const Timing& t, const char* work_name, long long work, long long result) {
+  std::printf("{\"version\":\"%s\",\"algo\":\"%s\",\"family\":\"%s\",\"n\":%d,\"threads\":%d,"
+              "\"seed\":%u,\"rep\":%d,\"%s\":%lld,\"result\":%lld,"
+              "\"convert_s\":%.6f,\"solve_s\":%.6f,\"output_s\":%.6f,\"total_s\":%.6f}\n",
+              CHT_VERSION, algo.c_str(), family.c_str(), opt.n, opt.threads, opt.seed, rep,
+              work_name, work, result, t.convert, t.solve, t.output,
+              t.convert + t.solve + t.output);
+  std::fflush(stdout);
+}
+
+void usage() {
+  std::fprintf(stderr,
+               "usage: bench_matching [--algo gs|bucket|hk|all] [--family NAME|all]\n"
+               "                      [--n N] [--reps R] [--threads T] [--seed S]\n");
+  std::exit(2);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options opt;
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (i + 1 >= argc) usage();
+    std::string value = argv[++i];
+    if (arg == "--algo") opt.algo = value;
+    else if (arg == "--family") opt.family = value;
+    else if (arg == "--n") opt.n = std::atoi(value.c_str());
+    else if (arg == "--reps") opt.reps = std::atoi(value.c_str());
+    else if (arg == "--threads") opt.threads = std::atoi(value.c_str());
+    else if (arg == "--seed") opt.seed = (unsigned)std::strtoul(value.c_str(), nullptr, 10);
+    else usage();
+  }
+  if (opt.n < 1 || opt.reps < 1 || opt.threads < 1) usage();
+
+  const std::vector<std::string> pref_families = {"uniform", "correlated", "master"};
+  const std::vector<std::string> market_families = {"blood", "sparse", "panel"};
+  auto wanted = [&](const std::string& family) { return opt.family == "all" || opt.family == family; };
+  bool known = opt.family == "all";
+  for (const auto& f : pref_families) known |= f == opt.family;
+  for (const auto& f : market_families) known |= f == opt.family;
+  if (!known) usage();
+
+  for (const std::string& algo : {std::string("gs"), std::string("bucket")}) {
+    if (opt.algo != "all" && opt.algo != algo) continue;
+    for (const std::string& family : pref_families) {
+      if (!wanted(family)) continue;
+      std::mt19937_64 rng(opt.seed);
+      PrefInstance inst = make_pref_instance(family, opt.n, rng);
+      for (int rep = 0; rep < opt.reps; rep++) {
+        long long proposals = 0, result = 0;
+        Timing t = algo == "gs" ? run_gs(inst, proposals, result)
+                                : run_bucket(inst, opt.threads, proposals, result);
+        emit(opt, algo, family, rep, t, "proposals", proposals, result);
+      }
+    }
+  }
+
+  if (opt.algo == "all" || opt.algo == "hk") {
+    for (const std::string& family : market_families) {
+      if (!wanted(family)) continue;
+      std::mt19937_64 rng(opt.seed);
+      MarketInstance market = make_market(family, opt.n, rng);
+      for (int rep = 0; rep < opt.reps; rep++) {
+        long long edges = 0, result = 0;
+        Timing t = run_hk(family, market, opt.threads, edges, result);
+        emit(opt, "hk", family, rep, t, "edges", edges, result);
+      }
+    }
+  }
+  return 0;
+}
@@ -1,17 +1,51 @@
 #include <Rcpp.h>
-#include <string>
-#include <vector>
-#include <map>
-#include <set>
 #include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "gale_shapley_engine.h"
 using namespace Rcpp;
 
+// Associe chaque nom à un identifiant entier (les CHARSXP restent vivants
+// pendant tout l'appel, on peut donc garder de simples vues dessus)
+static std::unordered_map<std::string_view, int> intern_names(const CharacterVector& names) {
+  std::unordered_map<std::string_view, int> index;
+  index.reserve(names.size());
+  for (int i = 0; i < names.size(); i++) {
+    index.emplace(CHAR(STRING_ELT(names, i)), i);
+  }
+  return index;
+}
+
+static int lookup_name(const std::unordered_map<std::string_view, int>& index,
+                       SEXP name, const char* side) {
+  auto it = index.find(CHAR(name));
+  if (it == index.end()) {
+    stop("unknown name '%s' in %s", CHAR(name), side);
+  }
+  return it->second;
+}
+
 //' Gale-Shapley Stable Matching Algorithm
  //'
  //' Implements the Gale-Shapley algorithm for stable matching using C++.
+ //' Names are converted once to integer ids, then the proposal loop runs on
+ //' contiguous preference and rank arrays in O(n^2).
+ //'
+ //' Lists may be partial. A man who reaches the end of his list stays
+ //' unmatched. A man missing from a woman's list ranks after every man she
+ //' lists, and all such men tie: she keeps the first of them who proposed.
+ //' Free men are taken from a stack, man 1 first, and a rejected man
+ //' proposes again at once. Names that are not agents raise an error.
  //'
  //' @param men_prefs A named list of men's preferences (each element is a character vector of women names)
  //' @param women_prefs A named list of women's preferences (each element is a character vector of men names)
+ //' @param stats If TRUE, the solver counts its work and the result carries
+ //'   it as attribute "stats": a list with proposals, rejections and seconds
+ //'   (time spent in the solver). Without it, the solver runs without any
+ //'   instrumentation
  //' @return A data.frame with columns "Man" and "Woman" representing the stable matches
  //' @examples
  //' men_prefs <- list(
@@ -27,92 +61,88 @@ using namespace Rcpp;
  //' gale_shapley_cpp(men_prefs, women_prefs)
  //' @export
  // [[Rcpp::export]]
- DataFrame gale_shapley_cpp(List men_prefs, List women_prefs) {
+ DataFrame gale_shapley_cpp(List men_prefs, List women_prefs, bool stats = false) {
    // Récupérer les noms des hommes et des femmes
    CharacterVector men_names = men_prefs.names();
    CharacterVector women_names = women_prefs.names();
    int n_men = men_names.size();
+   int n_women = women_names.size();
 
-   // Créer un ensemble des hommes libres
-   std::set<std::string> free_men;
-   for (int i = 0; i < n_men; i++) {
-     free_men.insert(as<std::string>(men_names[i]));
-   }
+   // Identifiants entiers, calculés une seule fois
+   auto men_index = intern_names(men_names);
+   auto women_index = intern_names(women_names);
 
-   // Map pour les fiançailles (femme -> homme)
-   std::map<std::string, std::string> engaged;
+   GSInstance inst;
+   inst.n_men = n_men;
+   inst.n_women = n_women;
 
-   // Map pour le prochain index de proposition de chaque homme
-   std::map<std::string, int> next_proposal;
+   // Listes de préférences des hommes, mises bout à bout
+   inst.pref_start.resize(n_men + 1);
+   inst.pref_start[0] = 0;
    for (int i = 0; i < n_men; i++) {
-     std::string man = as<std::string>(men_names[i]);
-     next_proposal[man] = 0;
+     CharacterVector prefs = men_prefs[i];
+     inst.pref_start[i + 1] = inst.pref_start[i] + prefs.size();
    }
-
-   // Créer la structure de rang pour chaque femme (femme -> (homme -> rang))
-   std::map<std::string, std::map<std::string, int>> rank;
-   for (int i = 0; i < women_names.size(); i++) {
-     std::string woman = as<std::string>(women_names[i]);
-     CharacterVector prefs = as<CharacterVector>(women_prefs[woman]);
+   inst.pref_list.resize(inst.pref_start[n_men]);
+   for (int i = 0; i < n_men; i++) {
+     CharacterVector prefs = men_prefs[i];
+     int* out = inst.pref_list.data() + inst.pref_start[i];
      for (int j = 0; j < prefs.size(); j++) {
-       std::string man = as<std::string>(prefs[j]);
-       rank[woman][man] = j;
+       out[j] = lookup_name(women_index, STRING_ELT(prefs, j), "men_prefs");
      }
    }
 
-   // Algorithme principal
-   while (!free_men.empty()) {
-     // Prendre le premier homme libre
-     std::string man = *free_men.begin();
-
-     // Obtenir les préférences de cet homme
-     CharacterVector man_pref_vec = as<CharacterVector>(men_prefs[man]);
-
-     // Vérifier si l'homme a encore des femmes à proposer
-     if (next_proposal[man] >= man_pref_vec.size()) {
-       // Plus de femmes à proposer, retirer de la liste
-       free_men.erase(man);
-       continue;
-     }
-
-     // La femme à qui il propose
-     std::string woman = as<std::string>(man_pref_vec[next_proposal[man]]);
-
-     // L'homme fait sa proposition
-     if (engaged.find(woman) == engaged.end()) {
-       // La femme est libre, elle accepte
-       engaged[woman] = man;
-       free_men.erase(man);
-     } else {
-       // La femme est déjà fiancée
-       std::string current = engaged[woman];
-
-       // Comparer les rangs
-       if (rank[woman][man] < rank[woman][current]) {
-         // La femme préfère le nouveau prétendant
-         engaged[woman] = man;
-         free_men.insert(current);
-         free_men.erase(man);
-       }
-       // Sinon, la femme rejette le prétendant (il reste libre)
+   // Table des rangs (femme x homme) ; un homme absent de la liste d'une
+   // femme est classé après tous ceux qu'elle a cités
+   inst.rank.assign((std::size_t)n_women * n_men, n_men);
+   for (int i = 0; i < n_women; i++) {
+     CharacterVector prefs = women_prefs[i];
+     int* rank = inst.rank.data() + (std::size_t)i * n_men;
+     for (int j = 0; j < prefs.size(); j++) {
+       rank[lookup_name(men_index, STRING_ELT(prefs, j), "women_prefs")] = j;
      }
+   }
 
-     // Incrémenter l'index de proposition
-     next_proposal[man]++;
+   // Algorithme principal, instrumenté seulement sur demande
+   std::vector<int> engaged;
+   GSScratch scratch;
+   SolverStats solver_stats;
+   auto start = std::chrono::steady_clock::now();
+   if (stats) {
+     gale_shapley_solve(inst, engaged, scratch, solver_stats);
+   } else {
+     gale_shapley_solve(inst, engaged, scratch);
    }
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
 
-   // Construire le DataFrame de résultat
-   std::vector<std::string> result_men;
-   std::vector<std::string> result_women;
+   // Construire le DataFrame de résultat, trié par nom de femme
+   std::vector<int> order;
+   for (int i = 0; i < n_women; i++) {
+     if (engaged[i] != -1) order.push_back(i);
+   }
+   std::sort(order.begin(), order.end(), [&](int a, int b) {
+     return std::strcmp(CHAR(STRING_ELT(women_names, a)),
+                        CHAR(STRING_ELT(women_names, b))) < 0;
+   });
 
-   for (auto it = engaged.begin(); it != engaged.end(); ++it) {
-     result_men.push_back(it->second);    // Man
-     result_women.push_back(it->first);   // Woman
+   CharacterVector result_men(order.size());
+   CharacterVector result_women(order.size());
+   for (std::size_t k = 0; k < order.size(); k++) {
+     result_men[k] = men_names[engaged[order[k]]];     // Man
+     result_women[k] = women_names[order[k]];          // Woman
    }
 
-   return DataFrame::create(
+   DataFrame result = DataFrame::create(
      Named("Man") = result_men,
      Named("Woman") = result_women,
      _["stringsAsFactors"] = false
    );
+   if (stats) {
+     result.attr("stats") = List::create(
+       Named("proposals") = (double)solver_stats.proposals,
+       Named("rejections") = (double)solver_stats.rejections,
+       Named("seconds") = seconds
+     );
+   }
+   return result;
  }
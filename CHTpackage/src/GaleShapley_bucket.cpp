@@ -1,142 +1,422 @@
 #include <Rcpp.h>
-#include <queue>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <numeric>
+#include <random>
 #include <vector>
 #include <string>
-#include <unordered_map>
+#include "gs_bucket_engine.h"
+#include "gs_parallel_engine.h"
 using namespace Rcpp;
 
+// Converts the named R lists into the contiguous preference store. Every
+// list must rank all n agents of the other side exactly once.
+template <typename Index>
+static void fill_preference_store(PreferenceStore<Index>& prefs,
+                                  const List& men_prefs, const List& women_prefs,
+                                  const CharacterVector& men_names,
+                                  const CharacterVector& women_names) {
+  int n = men_prefs.size();
+  if (women_prefs.size() != n) stop("men_prefs and women_prefs must have the same length");
+  prefs.reset(n);
+  // seen[a] = last agent whose list named a, to catch repeated names
+  std::vector<int> seen(n, -1);
+
+  // Convert men preferences to numeric indices
+  std::map<String,int> women_index;
+  for (int i = 0; i < n; i++)
+    women_index[women_names[i]] = i;
+  for (int h = 0; h < n; h++) {
+    CharacterVector v = men_prefs[h];
+    if (v.size() != n) stop("each preference list must rank all %d agents", n);
+    Index* row = prefs.men_pref(h);
+    for (int j = 0; j < n; j++) {
+      auto it = women_index.find(v[j]);
+      if (it == women_index.end()) stop("men_prefs: '%s' is not a woman", CHAR(STRING_ELT(v, j)));
+      if (seen[it->second] == h) stop("men_prefs: man %d lists '%s' twice", h + 1, CHAR(STRING_ELT(v, j)));
+      seen[it->second] = h;
+      row[j] = (Index)it->second;
+    }
+  }
+
+  // Convert women preferences straight into their rank table
+  std::map<String,int> men_index;
+  for (int i = 0; i < n; i++)
+    men_index[men_names[i]] = i;
+  std::fill(seen.begin(), seen.end(), -1);
+  for (int f = 0; f < n; f++) {
+    CharacterVector v = women_prefs[f];
+    if (v.size() != n) stop("each preference list must rank all %d agents", n);
+    Index* rank = prefs.women_rank(f);
+    for (int pos = 0; pos < n; pos++) {
+      auto it = men_index.find(v[pos]);
+      if (it == men_index.end()) stop("women_prefs: '%s' is not a man", CHAR(STRING_ELT(v, pos)));
+      if (seen[it->second] == f) stop("women_prefs: woman %d lists '%s' twice", f + 1, CHAR(STRING_ELT(v, pos)));
+      seen[it->second] = f;
+      rank[it->second] = (Index)pos;     // lower = better
+    }
+  }
+}
+
+// Checks that each agent of a 1-based n x n matrix lists 1..n exactly once,
+// so the engine can read the matrix without any further test
+static void check_permutations(const IntegerMatrix& m, std::ptrdiff_t agent_stride,
+                               std::ptrdiff_t pos_stride, const char* arg) {
+  int n = m.nrow();
+  if (m.ncol() != n) stop("%s must be a square matrix", arg);
+  std::vector<int> seen;
+  int bad = first_invalid_agent(m.begin(), n, agent_stride, pos_stride, seen);
+  if (bad != -1) stop("%s: agent %d does not list 1..%d exactly once", arg, bad + 1, n);
+}
+
+// Strides of an n x n column-major matrix holding one agent per column or row
+static void matrix_strides(const std::string& by, int n, std::ptrdiff_t& agent_stride,
+                           std::ptrdiff_t& pos_stride) {
+  if (by == "column") {
+    agent_stride = n;
+    pos_stride = 1;
+  } else if (by == "row") {
+    agent_stride = 1;
+    pos_stride = n;
+  } else {
+    stop("by must be \"column\" or \"row\", not '%s'", by.c_str());
+  }
+}
+
 //' Best-First Gale-Shapley (Bucket Version)
  //'
  //' C++ implementation of the bucket-based Gale-Shapley stable matching algorithm.
- //' Uses a bucket priority queue for proposal ordering.
+ //' Uses a bucket priority queue for proposal ordering. Each proposal costs
+ //' O(1), so the whole run is O(n^2). Preferences and ranks share one
+ //' allocation of 16-bit entries (32-bit when n > 65535).
+ //'
+ //' With threads > 1, all free men propose in parallel rounds and each woman
+ //' keeps the best proposal with an atomic compare-and-swap. The result is
+ //' the same man-optimal matching as the serial run.
  //'
  //' @param men_prefs A named list of men's preference vectors
  //' @param women_prefs A named list of women's preference vectors
+ //' @param threads Number of worker threads (1 = serial bucket engine)
+ //' @param stats If TRUE, the result carries attribute "stats": a list with
+ //'   proposals, rejections, max_bucket_depth (most men waiting in one bucket,
+ //'   NA for the parallel engine, which has no buckets) and seconds (time
+ //'   spent in the solver). Without it, the serial engine runs without any
+ //'   instrumentation
  //' @return A data.frame with matched couples (columns: Man, Woman)
  //' @export
  // [[Rcpp::export]]
- DataFrame best_gs_bucket_cpp(List men_prefs, List women_prefs) {
+ DataFrame best_gs_bucket_cpp(List men_prefs, List women_prefs, int threads = 1,
+                              bool stats = false) {
    int n = men_prefs.size();
    // Retrieve R names
    CharacterVector men_names   = men_prefs.names();
    CharacterVector women_names = women_prefs.names();
 
-   // Convert men preferences to numeric indices
-   std::vector<std::vector<int>> men_pref_num(n);
-   std::map<String,int> women_index;
-   for (int i = 0; i < n; i++)
-     women_index[women_names[i]] = i;
+   // Ranks and preferences fit in 16 bits up to n = 65535
+   std::vector<int> matching;
+   SolverStats solver_stats;
+   double seconds = 0;
+   dispatch_index_width(n, [&](auto index_type) {
+     using Index = decltype(index_type);
+     PreferenceStore<Index> prefs;
+     fill_preference_store(prefs, men_prefs, women_prefs, men_names, women_names);
+     auto start = std::chrono::steady_clock::now();
+     if (threads > 1) {
+       WorkerPool pool(threads);
+       // Every man ends up matched: all other proposals were rejected
+       solver_stats.proposals = gs_parallel_solve(prefs, matching, pool);
+       solver_stats.rejections = solver_stats.proposals - n;
+     } else if (stats) {
+       BucketWorkspace<Index> ws;
+       gs_bucket_solve(prefs, matching, ws, solver_stats);
+     } else {
+       gs_bucket_solve(prefs, matching);
+     }
+     seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   });
+
+   // Build final output data.frame
+   CharacterVector out_women(n);
    for (int h = 0; h < n; h++) {
-     CharacterVector v = men_prefs[h];
-     int m = v.size();
-     men_pref_num[h].resize(m);
-     for (int j = 0; j < m; j++)
-       men_pref_num[h][j] = women_index[v[j]];
+     int f = matching[h];
+     out_women[h] = women_names[f];
    }
 
-   // Convert women preferences
-   std::vector<std::vector<int>> women_pref_num(n);
-   std::map<String,int> men_index;
-   for (int i = 0; i < n; i++)
-     men_index[men_names[i]] = i;
-   for (int f = 0; f < n; f++) {
-     CharacterVector v = women_prefs[f];
-     int m = v.size();
-     women_pref_num[f].resize(m);
-     for (int j = 0; j < m; j++)
-       women_pref_num[f][j] = men_index[v[j]];
+   DataFrame result = DataFrame::create(
+     _["Man"] = men_names,
+     _["Woman"] = out_women,
+     _["stringsAsFactors"] = false
+   );
+   if (stats) {
+     result.attr("stats") = List::create(
+       _["proposals"] = (double)solver_stats.proposals,
+       _["rejections"] = (double)solver_stats.rejections,
+       _["max_bucket_depth"] = threads > 1 ? NA_INTEGER : solver_stats.max_bucket_depth,
+       _["seconds"] = seconds
+     );
    }
+   return result;
+ }
 
-   // Build women_rank
-   std::vector<std::vector<int>> women_rank(n, std::vector<int>(n));
-   for (int f = 0; f < n; f++) {
-     for (int pos = 0; pos < n; pos++) {
-       int man = women_pref_num[f][pos];
-       women_rank[f][man] = pos;     // lower = better
-     }
-   }
+//' Best-First Gale-Shapley on Integer Matrices
+ //'
+ //' Matrix input path of best_gs_bucket_cpp(). Preferences are n x n integer
+ //' matrices of 1-based ids, one agent per column (by = "column") or per row
+ //' (by = "row"). The engine reads the R memory in place through a strided
+ //' view: there is no copy and no string handling. Each matrix is checked
+ //' once to list 1..n for every agent.
+ //'
+ //' If women_ranks is TRUE, women_prefs already holds ranks (entry for woman
+ //' f and man h = position of h in her list), as produced by rank-based
+ //' pipelines, and is used as is. Otherwise it is inverted once into an
+ //' integer rank table.
+ //'
+ //' @param men_prefs Integer matrix of men's preferences
+ //' @param women_prefs Integer matrix of women's preferences or ranks
+ //' @param by "column" or "row": how agents are laid out in the matrices
+ //' @param women_ranks Whether women_prefs holds ranks instead of lists
+ //' @param men_names Optional names of the men, used only in the output
+ //' @param women_names Optional names of the women, used only in the output
+ //' @return A data.frame with matched couples (columns: Man, Woman), given as
+ //'   names when supplied and as 1-based ids otherwise
+ //' @export
+ // [[Rcpp::export]]
+ DataFrame best_gs_bucket_matrix_cpp(IntegerMatrix men_prefs, IntegerMatrix women_prefs,
+                                     std::string by = "column", bool women_ranks = false,
+                                     Nullable<CharacterVector> men_names = R_NilValue,
+                                     Nullable<CharacterVector> women_names = R_NilValue) {
+   int n = men_prefs.nrow();
+   if (women_prefs.nrow() != n) stop("men_prefs and women_prefs must have the same size");
+
+   std::ptrdiff_t agent_stride, pos_stride;
+   matrix_strides(by, n, agent_stride, pos_stride);
+   check_permutations(men_prefs, agent_stride, pos_stride, "men_prefs");
+   check_permutations(women_prefs, agent_stride, pos_stride, "women_prefs");
 
-   // State arrays
-   std::vector<int> next_choice(n, 0);
-   std::vector<int> matching(n, -1);
+   // Lists of women are turned into ranks, laid out like the input
+   const int* ranks = women_prefs.begin();
+   std::vector<int> inverted;
+   if (!women_ranks) {
+     invert_matrix_lists(ranks, n, agent_stride, pos_stride, inverted);
+     ranks = inverted.data();
+   }
 
-   // Buckets : vector of vector of pairs (h,f)
-   std::vector<std::vector<std::pair<int,int>>> buckets(n);
+   MatrixPreferences prefs(n, men_prefs.begin(), ranks, agent_stride, pos_stride);
+   std::vector<int> matching;
+   gs_bucket_solve(prefs, matching);
 
-   // Initialize bucket #0
-   for (int h = 0; h < n; h++) {
-     int f = men_pref_num[h][0];
-     buckets[0].push_back({h, f});
+   // Names only come in here
+   RObject out_men, out_women;
+   if (men_names.isNotNull()) {
+     CharacterVector names(men_names.get());
+     if (names.size() != n) stop("men_names must have %d names", n);
+     out_men = names;
+   } else {
+     out_men = IntegerVector(seq_len(n));
+   }
+   if (women_names.isNotNull()) {
+     CharacterVector names(women_names.get());
+     if (names.size() != n) stop("women_names must have %d names", n);
+     CharacterVector matched(n);
+     for (int h = 0; h < n; h++) matched[h] = names[matching[h]];
+     out_women = matched;
+   } else {
+     IntegerVector matched(n);
+     for (int h = 0; h < n; h++) matched[h] = matching[h] + 1;
+     out_women = matched;
    }
 
-   // Main loop
-   while (true) {
-     // Find first non-empty bucket
-     int p = -1;
-     for (int i = 0; i < n; i++) {
-       if (!buckets[i].empty()) {
-         p = i;
-         break;
+   return DataFrame::create(
+     _["Man"] = out_men,
+     _["Woman"] = out_women,
+     _["stringsAsFactors"] = false
+   );
+ }
+
+//' Batch Best-First Gale-Shapley
+ //'
+ //' Solves many independent markets in one call. Instances are given either
+ //' as two lists of integer matrices (men_prefs[[k]] and women_prefs[[k]],
+ //' sizes may differ between instances) or as two packed n x n x K integer
+ //' arrays. Matrices follow the layout of best_gs_bucket_matrix_cpp() and are
+ //' read in place; instances are handed out one at a time to a pool of
+ //' threads, each with its own engine workspace.
+ //'
+ //' @param men_prefs List of integer matrices or n x n x K integer array
+ //' @param women_prefs List of integer matrices or n x n x K integer array
+ //' @param threads Number of worker threads
+ //' @param by "column" or "row": how agents are laid out in the matrices
+ //' @param women_ranks Whether women_prefs holds ranks instead of lists
+ //' @return A data.frame with integer columns instance, Man and Woman
+ //'   (1-based), one row per man of every instance
+ //' @export
+ // [[Rcpp::export]]
+ DataFrame best_gs_bucket_batch_cpp(SEXP men_prefs, SEXP women_prefs, int threads = 1,
+                                    std::string by = "column", bool women_ranks = false) {
+   struct Instance {
+     int n;
+     const int* men;
+     const int* women;
+   };
+   std::vector<Instance> batch;
+   std::vector<IntegerVector> inputs;  // keeps coerced inputs alive
+
+   if (TYPEOF(men_prefs) == VECSXP) {
+     List men_list(men_prefs), women_list(women_prefs);
+     if (men_list.size() != women_list.size()) stop("men_prefs and women_prefs must hold as many instances");
+     for (int k = 0; k < men_list.size(); k++) {
+       IntegerMatrix men = men_list[k], women = women_list[k];
+       int n = men.nrow();
+       if (men.ncol() != n || women.nrow() != n || women.ncol() != n) {
+         stop("instance %d: preferences must be two n x n matrices", k + 1);
        }
+       inputs.push_back(men);
+       inputs.push_back(women);
+       batch.push_back({n, men.begin(), women.begin()});
      }
-     if (p == -1) break;
-
-     // Pop proposal
-     auto prop = buckets[p].back();
-     buckets[p].pop_back();
-     int h = prop.first;
-     int f = prop.second;
-
-     // Find current fiancé of f
-     int current = -1;
-     for (int i = 0; i < n; i++) {
-       if (matching[i] == f) {
-         current = i;
-         break;
-       }
+   } else {
+     IntegerVector men(men_prefs), women(women_prefs);
+     IntegerVector dim = men.attr("dim");
+     if (dim.size() != 3 || dim[0] != dim[1]) stop("men_prefs must be an n x n x K array");
+     IntegerVector women_dim = women.attr("dim");
+     if (women_dim.size() != 3 || !std::equal(dim.begin(), dim.end(), women_dim.begin())) {
+       stop("women_prefs must have the dimensions of men_prefs");
      }
-
-     if (current == -1) {
-       // free woman -> accept
-       matching[h] = f;
+     int n = dim[0];
+     inputs.push_back(men);
+     inputs.push_back(women);
+     for (int k = 0; k < dim[2]; k++) {
+       std::size_t offset = (std::size_t)k * n * n;
+       batch.push_back({n, men.begin() + offset, women.begin() + offset});
      }
-     else {
-       // woman compares men
-       int rc = women_rank[f][current];
-       int rn = women_rank[f][h];
-       if (rn < rc) {
-         // replace fiancé
-         matching[h] = f;
-         matching[current] = -1;
-         next_choice[current]++;
-         int nc = next_choice[current];
-         if (nc < n) {
-           int f2 = men_pref_num[current][nc];
-           buckets[nc].push_back({current, f2});
-         }
+   }
+
+   bool by_column = by == "column";
+   if (!by_column && by != "row") stop("by must be \"column\" or \"row\", not '%s'", by.c_str());
+
+   int n_instances = (int)batch.size();
+   std::vector<std::size_t> start(n_instances + 1, 0);
+   for (int k = 0; k < n_instances; k++) start[k + 1] = start[k] + batch[k].n;
+   IntegerVector out_instance(start[n_instances]), out_men(start[n_instances]), out_women(start[n_instances]);
+   int* instance_ptr = out_instance.begin();
+   int* men_ptr = out_men.begin();
+   int* women_ptr = out_women.begin();
+
+   // Worker threads only see raw pointers; errors are reported afterwards
+   std::vector<int> bad_side(n_instances, 0), bad_agent(n_instances, -1);
+   std::atomic<int> next_instance(0);
+   WorkerPool pool(std::max(1, std::min(threads, n_instances)));
+   pool.run([&](int) {
+     BucketWorkspace<uint32_t> ws;
+     std::vector<int> seen, inverted, matching;
+     for (;;) {
+       int k = next_instance.fetch_add(1);
+       if (k >= n_instances) break;
+       const Instance& inst = batch[k];
+       int n = inst.n;
+       std::ptrdiff_t agent_stride = by_column ? n : 1;
+       std::ptrdiff_t pos_stride = by_column ? 1 : n;
+
+       int bad = first_invalid_agent(inst.men, n, agent_stride, pos_stride, seen);
+       if (bad != -1) {
+         bad_side[k] = 1;
+         bad_agent[k] = bad;
+         continue;
        }
-       else {
-         // reject h
-         next_choice[h]++;
-         int nh = next_choice[h];
-         if (nh < n) {
-           int f2 = men_pref_num[h][nh];
-           buckets[nh].push_back({h, f2});
-         }
+       bad = first_invalid_agent(inst.women, n, agent_stride, pos_stride, seen);
+       if (bad != -1) {
+         bad_side[k] = 2;
+         bad_agent[k] = bad;
+         continue;
        }
+
+       const int* ranks = inst.women;
+       if (!women_ranks) {
+         invert_matrix_lists(ranks, n, agent_stride, pos_stride, inverted);
+         ranks = inverted.data();
+       }
+       MatrixPreferences prefs(n, inst.men, ranks, agent_stride, pos_stride);
+       gs_bucket_solve(prefs, matching, ws);
+
+       for (int h = 0; h < n; h++) {
+         instance_ptr[start[k] + h] = k + 1;
+         men_ptr[start[k] + h] = h + 1;
+         women_ptr[start[k] + h] = matching[h] + 1;
+       }
+     }
+   });
+
+   for (int k = 0; k < n_instances; k++) {
+     if (bad_side[k] != 0) {
+       stop("instance %d: %s agent %d does not list 1..%d exactly once", k + 1,
+            bad_side[k] == 1 ? "men_prefs" : "women_prefs", bad_agent[k] + 1, batch[k].n);
      }
    }
 
-   // Build final output data.frame
-   CharacterVector out_women(n);
-   for (int h = 0; h < n; h++) {
-     int f = matching[h];
-     out_women[h] = women_names[f];
+   return DataFrame::create(
+     _["instance"] = out_instance,
+     _["Man"] = out_men,
+     _["Woman"] = out_women
+   );
+ }
+
+//' Scaling Benchmark for the Bucket Gale-Shapley Engine
+ //'
+ //' Solves uniform random instances of each size directly in C++ and times
+ //' only the proposal loop (no list conversion). With O(1) work per proposal
+ //' the proposals_per_second column should stay roughly flat as n grows.
+ //'
+ //' @param sizes Integer vector of market sizes n
+ //' @param reps Number of random instances solved per size
+ //' @param seed Seed of the instance generator
+ //' @return A data.frame with columns n, proposals, seconds, proposals_per_second
+ //' @export
+ // [[Rcpp::export]]
+ DataFrame gs_bucket_scaling_cpp(IntegerVector sizes, int reps = 3, int seed = 42) {
+   int k = sizes.size();
+   IntegerVector out_n(k);
+   NumericVector out_proposals(k), out_seconds(k), out_rate(k);
+   std::mt19937 rng(seed);
+
+   for (int s = 0; s < k; s++) {
+     int n = sizes[s];
+     double proposals = 0, seconds = 0;
+
+     dispatch_index_width(n, [&](auto index_type) {
+       using Index = decltype(index_type);
+       PreferenceStore<Index> prefs;
+       prefs.reset(n);
+       std::vector<int> matching;
+
+       for (int r = 0; r < reps; r++) {
+         for (int i = 0; i < n; i++) {
+           Index* men_row = prefs.men_pref(i);
+           std::iota(men_row, men_row + n, Index(0));
+           std::shuffle(men_row, men_row + n, rng);
+           Index* rank_row = prefs.women_rank(i);
+           std::iota(rank_row, rank_row + n, Index(0));
+           std::shuffle(rank_row, rank_row + n, rng);
+         }
+
+         auto start = std::chrono::steady_clock::now();
+         proposals += gs_bucket_solve(prefs, matching);
+         auto end = std::chrono::steady_clock::now();
+         seconds += std::chrono::duration<double>(end - start).count();
+       }
+     });
+
+     out_n[s] = n;
+     out_proposals[s] = proposals / reps;
+     out_seconds[s] = seconds / reps;
+     out_rate[s] = seconds > 0 ? proposals / seconds : NA_REAL;
    }
 
    return DataFrame::create(
-     _["Man"] = men_names,
-     _["Woman"] = out_women,
-     _["stringsAsFactors"] = false
+     _["n"] = out_n,
+     _["proposals"] = out_proposals,
+     _["seconds"] = out_seconds,
+     _["proposals_per_second"] = out_rate
    );
  }
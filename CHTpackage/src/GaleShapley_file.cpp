@@ -0,0 +1,139 @@
+#include <Rcpp.h>
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "gs_mapped_engine.h"
+using namespace Rcpp;
+
+// 0-based copy of one 1-based list, checked to name distinct agents of 1..n
+static void read_list(const int* ids, int length, int n, const char* arg, int agent,
+                      std::vector<int>& seen, std::vector<int>& out) {
+  out.resize(length);
+  for (int k = 0; k < length; k++) {
+    int v = ids[k];
+    if (v == NA_INTEGER || v < 1 || v > n || seen[v - 1] == agent) {
+      stop("%s: agent %d does not list distinct ids of 1..%d", arg, agent + 1, n);
+    }
+    seen[v - 1] = agent;
+    out[k] = v - 1;
+  }
+}
+
+//' Write a Binary Preference File
+ //'
+ //' Stores a stable marriage instance in the binary format read by
+ //' best_gs_bucket_file_cpp(): a 64-byte header, then the men's and the
+ //' women's lists as 16-bit ids (32-bit when n > 65535). The file is
+ //' written through a small buffer, agent by agent.
+ //'
+ //' Preferences are either two n x n integer matrices of 1-based ids, one
+ //' agent per column (complete lists), or two lists of n integer vectors of
+ //' 1-based ids. Vectors may be shorter than n (truncated lists); the file
+ //' then also stores the offset of every list.
+ //'
+ //' @param path File to create (overwritten if it exists)
+ //' @param men_prefs Men's preferences (matrix or list)
+ //' @param women_prefs Women's preferences (matrix or list)
+ //' @return The size of the file in bytes
+ //' @export
+ // [[Rcpp::export]]
+ double gs_pref_file_write_cpp(std::string path, SEXP men_prefs, SEXP women_prefs) {
+   bool matrices = Rf_isMatrix(men_prefs) && Rf_isMatrix(women_prefs);
+   uint64_t size = 0;
+   if (matrices) {
+     IntegerMatrix men(men_prefs), women(women_prefs);
+     int n = men.ncol();
+     if (men.nrow() != n || women.nrow() != n || women.ncol() != n) {
+       stop("men_prefs and women_prefs must be square matrices of the same size");
+     }
+     PrefFileWriter writer(path, n);
+     std::vector<int> seen(n, -1), list;
+     for (int side = 0; side < 2; side++) {
+       const IntegerMatrix& m = side == 0 ? men : women;
+       const char* arg = side == 0 ? "men_prefs" : "women_prefs";
+       std::fill(seen.begin(), seen.end(), -1);
+       for (int a = 0; a < n; a++) {
+         read_list(m.begin() + (std::size_t)a * n, n, n, arg, a, seen, list);
+         writer.add_list(list.data(), n);
+       }
+     }
+     writer.finish();
+     size = writer.file_size();
+   } else {
+     if (TYPEOF(men_prefs) != VECSXP || TYPEOF(women_prefs) != VECSXP) {
+       stop("men_prefs and women_prefs must be two integer matrices or two lists");
+     }
+     List men(men_prefs), women(women_prefs);
+     int n = men.size();
+     if (women.size() != n) stop("men_prefs and women_prefs must have the same length");
+
+     // Lengths first: the offsets of the lists come before the lists
+     std::vector<IntegerVector> lists;
+     lists.reserve(2 * (std::size_t)n);
+     std::vector<uint64_t> lengths;
+     bool complete = true;
+     for (int side = 0; side < 2; side++) {
+       const List& l = side == 0 ? men : women;
+       for (int a = 0; a < n; a++) {
+         lists.push_back(as<IntegerVector>(l[a]));
+         if (lists.back().size() > n) {
+           stop("%s: agent %d lists more than %d ids", side == 0 ? "men_prefs" : "women_prefs",
+                a + 1, n);
+         }
+         lengths.push_back(lists.back().size());
+         complete = complete && lists.back().size() == n;
+       }
+     }
+
+     PrefFileWriter writer(path, n, complete ? nullptr : &lengths);
+     std::vector<int> seen(n, -1), list;
+     for (int i = 0; i < 2 * n; i++) {
+       if (i == n) std::fill(seen.begin(), seen.end(), -1);
+       const IntegerVector& v = lists[i];
+       read_list(v.begin(), v.size(), n, i < n ? "men_prefs" : "women_prefs", i % n, seen, list);
+       writer.add_list(list.data(), list.size());
+     }
+     writer.finish();
+     size = writer.file_size();
+   }
+   return (double)size;
+ }
+
+//' Best-First Gale-Shapley on a Binary Preference File
+ //'
+ //' Solves the instance stored by gs_pref_file_write_cpp() (or any tool
+ //' writing the same format, see src/gs_mapped_engine.h) without loading it
+ //' into R. The file is memory-mapped and the bucket engine reads the men's
+ //' lists in place; the women's lists are turned into the rank table in one
+ //' sequential pass, which also checks them. Only the pages the engine
+ //' touches are read, so instances larger than RAM can be solved.
+ //'
+ //' With truncated lists a man only proposes to the women he lists, and a
+ //' woman ranks the men she does not list after all the others (between
+ //' two of them she keeps the one she holds), as in gale_shapley_cpp().
+ //'
+ //' @param path Preference file
+ //' @param rank_file Optional scratch file for the rank table (n^2 ids, the
+ //'   size of one side of the file), removed afterwards. By default the
+ //'   table is held in memory
+ //' @return A data.frame with one row per man (columns: Man, Woman, as
+ //'   1-based ids); Woman is NA for a man left unmatched
+ //' @export
+ // [[Rcpp::export]]
+ DataFrame best_gs_bucket_file_cpp(std::string path,
+                                   Nullable<CharacterVector> rank_file = R_NilValue) {
+   std::string rank_path;
+   if (rank_file.isNotNull()) rank_path = as<std::string>(rank_file.get());
+
+   std::vector<int> matching;
+   gs_solve_pref_file(path, rank_path, matching);
+
+   int n = matching.size();
+   IntegerVector woman(n);
+   for (int h = 0; h < n; h++) woman[h] = matching[h] == -1 ? NA_INTEGER : matching[h] + 1;
+   return DataFrame::create(
+     _["Man"] = IntegerVector(seq_len(n)),
+     _["Woman"] = woman
+   );
+ }
@@ -0,0 +1,108 @@
+#include <Rcpp.h>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include "stable_lattice_engine.h"
+using namespace Rcpp;
+
+// Names -> ids; the CHARSXPs outlive the call, so views on them are enough
+static std::unordered_map<std::string_view, int> index_names(const CharacterVector& names) {
+  std::unordered_map<std::string_view, int> index;
+  index.reserve(names.size());
+  for (int i = 0; i < names.size(); i++) {
+    index.emplace(CHAR(STRING_ELT(names, i)), i);
+  }
+  return index;
+}
+
+// Complete lists only: every agent must rank all n agents of the other side
+static void fill_lists(const List& prefs, const std::unordered_map<std::string_view, int>& index,
+                       int n, const char* side, std::vector<int>& out) {
+  out.resize((std::size_t)n * n);
+  for (int a = 0; a < n; a++) {
+    CharacterVector v = prefs[a];
+    if (v.size() != n) stop("%s: every list must rank all %d agents", side, n);
+    std::vector<char> seen(n, 0);
+    for (int k = 0; k < n; k++) {
+      auto it = index.find(CHAR(STRING_ELT(v, k)));
+      if (it == index.end()) stop("unknown name '%s' in %s", CHAR(STRING_ELT(v, k)), side);
+      if (seen[it->second]) stop("%s: '%s' is listed twice", side, CHAR(STRING_ELT(v, k)));
+      seen[it->second] = 1;
+      out[(std::size_t)a * n + k] = it->second;
+    }
+  }
+}
+
+static DataFrame matching_frame(const std::vector<int>& wife, const CharacterVector& men_names,
+                                const CharacterVector& women_names) {
+  CharacterVector out_women(wife.size());
+  for (std::size_t m = 0; m < wife.size(); m++) out_women[m] = women_names[wife[m]];
+  return DataFrame::create(
+    _["Man"] = men_names,
+    _["Woman"] = out_women,
+    _["stringsAsFactors"] = false
+  );
+}
+
+//' Optimal Stable Matchings over the Rotation Poset
+ //'
+ //' Builds the rotation poset of the instance from the man-optimal and
+ //' woman-optimal Gale-Shapley runs in O(n^2), then returns four stable
+ //' matchings without enumerating the lattice: man-optimal, woman-optimal,
+ //' minimum regret (smallest worst rank given by any agent to its partner,
+ //' by Gusfield's forced-move method) and egalitarian (smallest sum of ranks
+ //' over all agents, as a minimum cut over the rotations).
+ //'
+ //' @param men_prefs A named list of men's complete preference vectors
+ //' @param women_prefs A named list of women's complete preference vectors
+ //' @return A list with data.frames man_optimal, woman_optimal,
+ //'   minimum_regret and egalitarian (columns: Man, Woman), a summary
+ //'   data.frame (matching, regret, egalitarian_cost; ranks are 1-based) and
+ //'   the number of rotations
+ //' @examples
+ //' men_prefs <- list(A = c("X", "Y"), B = c("Y", "X"))
+ //' women_prefs <- list(X = c("B", "A"), Y = c("A", "B"))
+ //' stable_matchings_cpp(men_prefs, women_prefs)$woman_optimal
+ //' @export
+ // [[Rcpp::export]]
+ List stable_matchings_cpp(List men_prefs, List women_prefs) {
+   CharacterVector men_names = men_prefs.names();
+   CharacterVector women_names = women_prefs.names();
+   int n = men_names.size();
+   if (women_names.size() != n) stop("men_prefs and women_prefs must have the same size");
+
+   std::vector<int> men_lists, women_lists;
+   fill_lists(men_prefs, index_names(women_names), n, "men_prefs", men_lists);
+   fill_lists(women_prefs, index_names(men_names), n, "women_prefs", women_lists);
+
+   RotationPoset poset;
+   poset.build(n, men_lists.data(), women_lists.data());
+
+   std::vector<std::vector<int>> matchings = {
+     poset.man_optimal(), poset.woman_optimal(), poset.minimum_regret(), poset.egalitarian()
+   };
+   CharacterVector labels = CharacterVector::create("man_optimal", "woman_optimal",
+                                                    "minimum_regret", "egalitarian");
+   List frames(matchings.size());
+   IntegerVector regret(matchings.size());
+   NumericVector cost(matchings.size());
+   for (std::size_t i = 0; i < matchings.size(); i++) {
+     frames[i] = matching_frame(matchings[i], men_names, women_names);
+     regret[i] = poset.regret(matchings[i]);
+     cost[i] = (double)poset.egalitarian_cost(matchings[i]);
+   }
+
+   return List::create(
+     _["man_optimal"] = frames[0],
+     _["woman_optimal"] = frames[1],
+     _["minimum_regret"] = frames[2],
+     _["egalitarian"] = frames[3],
+     _["summary"] = DataFrame::create(
+       _["matching"] = labels,
+       _["regret"] = regret,
+       _["egalitarian_cost"] = cost,
+       _["stringsAsFactors"] = false
+     ),
+     _["n_rotations"] = poset.n_rotations()
+   );
+ }
@@ -0,0 +1,227 @@
+#include <Rcpp.h>
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "gs_bucket_engine.h"
+#include "matching_verifier.h"
+using namespace Rcpp;
+
+// Agents of one side, found by 1-based id or, when the preferences are named
+// lists, by name. R keeps one CHARSXP per distinct string, so names are
+// compared by pointer first; strcmp only serves for the same text in
+// another encoding.
+struct AgentIndex {
+  int n = 0;
+  SEXP names = R_NilValue;
+  std::unordered_map<SEXP, int> by_name;
+
+  AgentIndex(int n_agents, SEXP agent_names) : n(n_agents), names(agent_names) {
+    if (names == R_NilValue) return;
+    by_name.reserve(n);
+    for (int a = 0; a < n; a++) {
+      if (!by_name.emplace(STRING_ELT(names, a), a).second) {
+        stop("agent name '%s' is used twice", CHAR(STRING_ELT(names, a)));
+      }
+    }
+  }
+
+  // 0-based agent of entry i of a character, integer or numeric vector;
+  // -1 for NA, stop() for anything else that is not an agent
+  int find(SEXP values, R_xlen_t i, const char* arg) const {
+    if (TYPEOF(values) == STRSXP) {
+      SEXP s = STRING_ELT(values, i);
+      if (s == NA_STRING) return -1;
+      auto it = by_name.find(s);
+      if (it != by_name.end()) return it->second;
+      for (int a = 0; a < n && names != R_NilValue; a++) {
+        if (std::strcmp(CHAR(s), CHAR(STRING_ELT(names, a))) == 0) return a;
+      }
+      stop("%s: '%s' is not an agent", arg, CHAR(s));
+    }
+    double id;
+    if (TYPEOF(values) == INTSXP) {
+      int v = INTEGER(values)[i];
+      if (v == NA_INTEGER) return -1;
+      id = v;
+    } else if (TYPEOF(values) == REALSXP) {
+      id = REAL(values)[i];
+      if (ISNAN(id)) return -1;
+    } else {
+      stop("%s must hold names or ids", arg);
+    }
+    if (id < 1 || id > n || id != (int)id) stop("%s: %g is not an id of 1..%d", arg, id, n);
+    return (int)id - 1;
+  }
+
+  SEXP label(int a) const {
+    if (names == R_NilValue) return wrap(a == -1 ? NA_INTEGER : a + 1);
+    if (a == -1) return wrap(CharacterVector::create(NA_STRING));
+    return ScalarString(STRING_ELT(names, a));
+  }
+};
+
+// Named lists of complete preferences as 1-based n x n matrices, one agent
+// per column, checked to list every agent of the other side once
+static void lists_as_matrix(const List& prefs, const AgentIndex& other, const char* arg,
+                            std::vector<int>& out) {
+  int n = prefs.size();
+  out.resize((std::size_t)n * n);
+  std::vector<int> seen(n, -1);
+  for (int a = 0; a < n; a++) {
+    SEXP list = prefs[a];
+    if (TYPEOF(list) != STRSXP || Rf_xlength(list) != n) {
+      stop("%s: agent %d must list the %d agents of the other side", arg, a + 1, n);
+    }
+    for (int k = 0; k < n; k++) {
+      int b = other.find(list, k, arg);
+      if (b == -1 || seen[b] == a) stop("%s: agent %d does not list every agent once", arg, a + 1);
+      seen[b] = a;
+      out[(std::size_t)a * n + k] = b + 1;
+    }
+  }
+}
+
+// wife[h] of every man from a data.frame with columns Man and Woman; men
+// absent from it and rows with Woman = NA are unmatched
+static std::vector<int> read_matching(const DataFrame& matching, const AgentIndex& men,
+                                      const AgentIndex& women, const char* arg) {
+  if (!matching.containsElementNamed("Man") || !matching.containsElementNamed("Woman")) {
+    stop("%s must have columns Man and Woman", arg);
+  }
+  SEXP man_col = matching["Man"], woman_col = matching["Woman"];
+  if (Rf_isFactor(man_col) || Rf_isFactor(woman_col)) {
+    stop("%s: Man and Woman must be names or ids, not factors", arg);
+  }
+  std::vector<int> wife(men.n, -1), taken(women.n, 0);
+  for (R_xlen_t i = 0; i < Rf_xlength(man_col); i++) {
+    int h = men.find(man_col, i, arg);
+    int f = women.find(woman_col, i, arg);
+    if (h == -1) {
+      if (f != -1) stop("%s: row %d has a woman but no man", arg, (int)i + 1);
+      continue;
+    }
+    if (wife[h] != -1) stop("%s: man %d appears twice", arg, h + 1);
+    if (f != -1 && taken[f]++) stop("%s: woman %d is matched twice", arg, f + 1);
+    wife[h] = f;
+  }
+  return wife;
+}
+
+//' Verify a Stable Matching
+ //'
+ //' Audits the result of a Gale-Shapley solver in C++: it looks for a
+ //' blocking pair (a man and a woman who both prefer each other to their
+ //' partners), and optionally compares the matching with a reference to
+ //' confirm that it is man-optimal. Each man's list is only read up to his
+ //' wife, so the check is O(n^2) at worst and stops at the first blocking
+ //' man found; men are split between threads, and the reported pair is the
+ //' same for any number of threads.
+ //'
+ //' Preferences are given as for best_gs_bucket_cpp() (named lists, the
+ //' matching then holds names) or as for best_gs_bucket_matrix_cpp() (n x n
+ //' integer matrices of 1-based ids, one agent per column, the matching then
+ //' holds ids). Lists must be complete.
+ //'
+ //' @param men_prefs Men's preferences (named list or integer matrix)
+ //' @param women_prefs Women's preferences (named list or integer matrix)
+ //' @param matching A data.frame with columns Man and Woman, such as the
+ //'   output of the solvers; absent men and Woman = NA mean unmatched
+ //' @param reference Optional matching in the same format, taken as the
+ //'   man-optimal one (for instance best_gs_bucket_cpp() output)
+ //' @param threads Number of worker threads
+ //' @return A list with stable (logical), blocking_man and blocking_woman
+ //'   (the lowest blocking man and the first woman of his list who blocks
+ //'   with him, NA if stable), men_worse_off (number of men with a wife they
+ //'   rank below their reference wife, NA without reference), man_optimal
+ //'   (stable and no man worse off, NA without reference) and seconds
+ //' @export
+ // [[Rcpp::export]]
+ List verify_stable_matching_cpp(SEXP men_prefs, SEXP women_prefs, DataFrame matching,
+                                 Nullable<DataFrame> reference = R_NilValue, int threads = 1) {
+   if (threads < 1) stop("threads must be at least 1");
+   bool matrices = Rf_isMatrix(men_prefs) && Rf_isMatrix(women_prefs);
+   if (!matrices && (TYPEOF(men_prefs) != VECSXP || TYPEOF(women_prefs) != VECSXP)) {
+     stop("men_prefs and women_prefs must be two integer matrices or two named lists");
+   }
+
+   int n;
+   std::vector<int> men_lists, women_lists;
+   const int* men_data;
+   const int* women_data;
+   SEXP men_names = R_NilValue, women_names = R_NilValue;
+   IntegerMatrix men_matrix, women_matrix;
+   if (matrices) {
+     men_matrix = men_prefs;
+     women_matrix = women_prefs;
+     n = men_matrix.ncol();
+     if (men_matrix.nrow() != n || women_matrix.nrow() != n || women_matrix.ncol() != n) {
+       stop("men_prefs and women_prefs must be square matrices of the same size");
+     }
+     std::vector<int> seen;
+     int bad = first_invalid_agent(men_matrix.begin(), n, n, 1, seen);
+     if (bad != -1) stop("men_prefs: agent %d does not list 1..%d exactly once", bad + 1, n);
+     bad = first_invalid_agent(women_matrix.begin(), n, n, 1, seen);
+     if (bad != -1) stop("women_prefs: agent %d does not list 1..%d exactly once", bad + 1, n);
+     men_data = men_matrix.begin();
+     women_data = women_matrix.begin();
+   } else {
+     n = Rf_length(men_prefs);
+     if (Rf_length(women_prefs) != n) stop("men_prefs and women_prefs must have the same length");
+     men_names = Rf_getAttrib(men_prefs, R_NamesSymbol);
+     women_names = Rf_getAttrib(women_prefs, R_NamesSymbol);
+     if (men_names == R_NilValue || women_names == R_NilValue) {
+       stop("men_prefs and women_prefs must be named lists");
+     }
+   }
+   AgentIndex men_index(n, men_names), women_index(n, women_names);
+   if (!matrices) {
+     lists_as_matrix(List(men_prefs), women_index, "men_prefs", men_lists);
+     lists_as_matrix(List(women_prefs), men_index, "women_prefs", women_lists);
+     men_data = men_lists.data();
+     women_data = women_lists.data();
+   }
+
+   std::vector<int> wife = read_matching(matching, men_index, women_index, "matching");
+   std::vector<int> husband(n, -1);
+   for (int h = 0; h < n; h++) {
+     if (wife[h] != -1) husband[wife[h]] = h;
+   }
+   std::vector<int> reference_wife;
+   if (reference.isNotNull()) {
+     reference_wife = read_matching(DataFrame(reference.get()), men_index, women_index, "reference");
+   }
+
+   std::vector<int> ranks;
+   invert_matrix_lists(women_data, n, n, 1, ranks);
+   MatrixPreferences prefs(n, men_data, ranks.data(), n, 1);
+
+   auto start = std::chrono::steady_clock::now();
+   int blocking_woman = -1, first_worse = -1;
+   long long worse = 0;
+   int blocking_man;
+   {
+     WorkerPool pool(threads);
+     blocking_man = first_blocking_man(prefs, wife, husband, pool, blocking_woman);
+     if (reference.isNotNull()) {
+       worse = count_men_worse_off(prefs, wife, reference_wife, pool, first_worse);
+     }
+   }
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+   bool stable = blocking_man == -1;
+   RObject men_worse_off = wrap(NA_REAL), man_optimal = LogicalVector::create(NA_LOGICAL);
+   if (reference.isNotNull()) {
+     men_worse_off = wrap((double)worse);
+     man_optimal = wrap(stable && worse == 0);
+   }
+   return List::create(
+     _["stable"] = stable,
+     _["blocking_man"] = men_index.label(blocking_man),
+     _["blocking_woman"] = women_index.label(blocking_woman),
+     _["men_worse_off"] = men_worse_off,
+     _["man_optimal"] = man_optimal,
+     _["seconds"] = seconds
+   );
+ }
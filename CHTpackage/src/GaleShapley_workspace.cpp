@@ -0,0 +1,264 @@
+#include <Rcpp.h>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "gale_shapley_engine.h"
+#include "gs_bucket_engine.h"
+using namespace Rcpp;
+
+// Name -> id table keyed by CHARSXP address. R keeps one CHARSXP per
+// distinct string, so comparing addresses compares names and no string is
+// hashed. The last names vector is kept alive, which keeps its CHARSXPs at
+// the same addresses, and the table is rebuilt only when names change.
+class CharsxpIndex {
+public:
+  // Returns true when the table had to be rebuilt.
+  bool assign(const CharacterVector& names) {
+    int n = names.size();
+    if (!keys_.empty() && names_.size() == n) {
+      bool same = true;
+      for (int i = 0; i < n && same; i++) same = STRING_ELT(names, i) == STRING_ELT(names_, i);
+      if (same) return false;
+    }
+
+    names_ = names;
+    std::size_t capacity = 16;
+    while (capacity < 2 * (std::size_t)n) capacity *= 2;
+    keys_.assign(capacity, nullptr);
+    ids_.resize(capacity);
+    mask_ = capacity - 1;
+    for (int i = 0; i < n; i++) {
+      SEXP key = STRING_ELT(names, i);
+      std::size_t slot = hash(key);
+      while (keys_[slot] != nullptr && keys_[slot] != key) slot = (slot + 1) & mask_;
+      if (keys_[slot] == key) stop("duplicated name '%s'", CHAR(key));
+      keys_[slot] = key;
+      ids_[slot] = i;
+    }
+    return true;
+  }
+
+  const CharacterVector& names() const { return names_; }
+
+  int find(SEXP key, const char* side) const {
+    std::size_t slot = hash(key);
+    while (keys_[slot] != nullptr) {
+      if (keys_[slot] == key) return ids_[slot];
+      slot = (slot + 1) & mask_;
+    }
+    // Same text in another encoding has another CHARSXP
+    for (int i = 0; i < names_.size(); i++) {
+      if (std::strcmp(CHAR(key), CHAR(STRING_ELT(names_, i))) == 0) return i;
+    }
+    stop("unknown name '%s' in %s", CHAR(key), side);
+  }
+
+private:
+  std::size_t hash(SEXP key) const {
+    return (std::size_t)(((uintptr_t)key >> 4) * UINT64_C(0x9E3779B97F4A7C15) >> 17) & mask_;
+  }
+
+  CharacterVector names_ = CharacterVector(0);
+  std::vector<SEXP> keys_;
+  std::vector<int> ids_;
+  std::size_t mask_ = 0;
+};
+
+template <typename Index>
+struct BucketBuffers {
+  PreferenceStore<Index> prefs;
+  BucketWorkspace<Index> ws;
+};
+
+// Everything a solve needs, kept between calls behind an external pointer.
+struct GSWorkspace {
+  CharsxpIndex men_index, women_index;
+  BucketBuffers<uint16_t> bucket16;
+  BucketBuffers<uint32_t> bucket32;
+  GSInstance instance;
+  GSScratch scratch;
+  std::vector<int> matching;
+  std::vector<int> women_by_name;  // women ids sorted by name
+  std::vector<int> seen;           // last list naming each agent
+};
+
+static BucketBuffers<uint16_t>& bucket_buffers(GSWorkspace& ws, uint16_t) { return ws.bucket16; }
+static BucketBuffers<uint32_t>& bucket_buffers(GSWorkspace& ws, uint32_t) { return ws.bucket32; }
+
+static GSWorkspace& get_workspace(SEXP workspace) {
+  if (TYPEOF(workspace) != EXTPTRSXP || R_ExternalPtrAddr(workspace) == nullptr) {
+    stop("workspace is not a live Gale-Shapley workspace");
+  }
+  return *static_cast<GSWorkspace*>(R_ExternalPtrAddr(workspace));
+}
+
+// Same output as best_gs_bucket_cpp(): one row per man, in input order
+static DataFrame solve_bucket(GSWorkspace& ws, const List& men_prefs, const List& women_prefs) {
+  int n = men_prefs.size();
+  if (women_prefs.size() != n) {
+    stop("the bucket algorithm needs as many women as men");
+  }
+
+  dispatch_index_width(n, [&](auto index_type) {
+    using Index = decltype(index_type);
+    BucketBuffers<Index>& buffers = bucket_buffers(ws, Index());
+    PreferenceStore<Index>& prefs = buffers.prefs;
+    prefs.reset(n);
+
+    // The store is not cleared between solves: a list that repeats a name
+    // would leave entries of the previous instance in place
+    std::vector<int>& seen = ws.seen;
+    seen.assign(n, -1);
+    for (int h = 0; h < n; h++) {
+      SEXP v = men_prefs[h];
+      if (Rf_xlength(v) != n) stop("each preference list must rank all %d agents", n);
+      Index* row = prefs.men_pref(h);
+      for (int j = 0; j < n; j++) {
+        int f = ws.women_index.find(STRING_ELT(v, j), "men_prefs");
+        if (seen[f] == h) stop("men_prefs: man %d lists '%s' twice", h + 1, CHAR(STRING_ELT(v, j)));
+        seen[f] = h;
+        row[j] = (Index)f;
+      }
+    }
+    seen.assign(n, -1);
+    for (int f = 0; f < n; f++) {
+      SEXP v = women_prefs[f];
+      if (Rf_xlength(v) != n) stop("each preference list must rank all %d agents", n);
+      Index* rank = prefs.women_rank(f);
+      for (int pos = 0; pos < n; pos++) {
+        int h = ws.men_index.find(STRING_ELT(v, pos), "women_prefs");
+        if (seen[h] == f) stop("women_prefs: woman %d lists '%s' twice", f + 1, CHAR(STRING_ELT(v, pos)));
+        seen[h] = f;
+        rank[h] = (Index)pos;
+      }
+    }
+
+    gs_bucket_solve(prefs, ws.matching, buffers.ws);
+  });
+
+  const CharacterVector& women_names = ws.women_index.names();
+  CharacterVector out_women(n);
+  for (int h = 0; h < n; h++) {
+    out_women[h] = women_names[ws.matching[h]];
+  }
+
+  return DataFrame::create(
+    _["Man"] = ws.men_index.names(),
+    _["Woman"] = out_women,
+    _["stringsAsFactors"] = false
+  );
+}
+
+// Same output as gale_shapley_cpp(): engaged couples sorted by woman name
+static DataFrame solve_classic(GSWorkspace& ws, const List& men_prefs, const List& women_prefs) {
+  int n_men = men_prefs.size();
+  int n_women = women_prefs.size();
+  GSInstance& inst = ws.instance;
+  inst.n_men = n_men;
+  inst.n_women = n_women;
+
+  inst.pref_start.resize(n_men + 1);
+  inst.pref_start[0] = 0;
+  for (int i = 0; i < n_men; i++) {
+    inst.pref_start[i + 1] = inst.pref_start[i] + (int)Rf_xlength(men_prefs[i]);
+  }
+  inst.pref_list.resize(inst.pref_start[n_men]);
+  for (int i = 0; i < n_men; i++) {
+    SEXP prefs = men_prefs[i];
+    int* out = inst.pref_list.data() + inst.pref_start[i];
+    for (int j = 0; j < Rf_xlength(prefs); j++) {
+      out[j] = ws.women_index.find(STRING_ELT(prefs, j), "men_prefs");
+    }
+  }
+
+  inst.rank.assign((std::size_t)n_women * n_men, n_men);
+  for (int i = 0; i < n_women; i++) {
+    SEXP prefs = women_prefs[i];
+    int* rank = inst.rank.data() + (std::size_t)i * n_men;
+    for (int j = 0; j < Rf_xlength(prefs); j++) {
+      rank[ws.men_index.find(STRING_ELT(prefs, j), "women_prefs")] = j;
+    }
+  }
+
+  gale_shapley_solve(inst, ws.matching, ws.scratch);
+
+  const CharacterVector& men_names = ws.men_index.names();
+  const CharacterVector& women_names = ws.women_index.names();
+  int n_engaged = 0;
+  for (int w : ws.women_by_name) n_engaged += ws.matching[w] != -1;
+  CharacterVector result_men(n_engaged);
+  CharacterVector result_women(n_engaged);
+  int k = 0;
+  for (int w : ws.women_by_name) {
+    if (ws.matching[w] == -1) continue;
+    result_men[k] = men_names[ws.matching[w]];
+    result_women[k] = women_names[w];
+    k++;
+  }
+
+  return DataFrame::create(
+    Named("Man") = result_men,
+    Named("Woman") = result_women,
+    _["stringsAsFactors"] = false
+  );
+}
+
+//' Reusable Gale-Shapley Workspace
+ //'
+ //' Creates a workspace for repeated calls to gs_workspace_solve(). The
+ //' workspace keeps the name indices, preference and rank tables, engine
+ //' arrays and result buffers between calls and only reallocates when n
+ //' grows, so a Monte Carlo loop over same-sized instances does no index
+ //' building or allocation outside the returned data.frame.
+ //'
+ //' @return An external pointer to the workspace
+ //' @examples
+ //' ws <- gs_workspace_new()
+ //' men_prefs <- list(A = c("X", "Y"), B = c("Y", "X"))
+ //' women_prefs <- list(X = c("A", "B"), Y = c("B", "A"))
+ //' gs_workspace_solve(ws, men_prefs, women_prefs)
+ //' @export
+ // [[Rcpp::export]]
+ SEXP gs_workspace_new() {
+   return XPtr<GSWorkspace>(new GSWorkspace(), true);
+ }
+
+//' Solve a Stable Matching Instance in a Workspace
+ //'
+ //' Gives the same result as best_gs_bucket_cpp() (algorithm = "bucket") or
+ //' gale_shapley_cpp() (algorithm = "classic"). Names are looked up through
+ //' tables keyed by the R string cache, rebuilt only when the names of the
+ //' lists change from one call to the next.
+ //'
+ //' @param workspace A workspace created by gs_workspace_new()
+ //' @param men_prefs A named list of men's preference vectors
+ //' @param women_prefs A named list of women's preference vectors
+ //' @param algorithm "bucket" or "classic"
+ //' @return A data.frame with matched couples (columns: Man, Woman)
+ //' @export
+ // [[Rcpp::export]]
+ DataFrame gs_workspace_solve(SEXP workspace, List men_prefs, List women_prefs,
+                              std::string algorithm = "bucket") {
+   GSWorkspace& ws = get_workspace(workspace);
+   bool bucket = algorithm == "bucket";
+   if (!bucket && algorithm != "classic") {
+     stop("algorithm must be \"bucket\" or \"classic\", not '%s'", algorithm.c_str());
+   }
+
+   CharacterVector men_names = men_prefs.names();
+   CharacterVector women_names = women_prefs.names();
+   ws.men_index.assign(men_names);
+   if (ws.women_index.assign(women_names)) {
+     ws.women_by_name.resize(women_names.size());
+     for (int i = 0; i < women_names.size(); i++) ws.women_by_name[i] = i;
+     std::sort(ws.women_by_name.begin(), ws.women_by_name.end(), [&](int a, int b) {
+       return std::strcmp(CHAR(STRING_ELT(women_names, a)),
+                          CHAR(STRING_ELT(women_names, b))) < 0;
+     });
+   }
+
+   return bucket ? solve_bucket(ws, men_prefs, women_prefs)
+                 : solve_classic(ws, men_prefs, women_prefs);
+ }
@@ -11,26 +11,240 @@ Rcpp::Rostream<false>& Rcpp::Rcerr = Rcpp::Rcpp_cerr_get();
 #endif
 
 // gale_shapley_cpp
-DataFrame gale_shapley_cpp(List men_prefs, List women_prefs);
-RcppExport SEXP _CHTpackage_gale_shapley_cpp(SEXP men_prefsSEXP, SEXP women_prefsSEXP) {
+DataFrame gale_shapley_cpp(List men_prefs, List women_prefs, bool stats);
+RcppExport SEXP _CHTpackage_gale_shapley_cpp(SEXP men_prefsSEXP, SEXP women_prefsSEXP, SEXP statsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type men_prefs(men_prefsSEXP);
     Rcpp::traits::input_parameter< List >::type women_prefs(women_prefsSEXP);
-    rcpp_result_gen = Rcpp::wrap(gale_shapley_cpp(men_prefs, women_prefs));
+    Rcpp::traits::input_parameter< bool >::type stats(statsSEXP);
+    rcpp_result_gen = Rcpp::wrap(gale_shapley_cpp(men_prefs, women_prefs, stats));
     return rcpp_result_gen;
 END_RCPP
 }
 // best_gs_bucket_cpp
-DataFrame best_gs_bucket_cpp(List men_prefs, List women_prefs);
-RcppExport SEXP _CHTpackage_best_gs_bucket_cpp(SEXP men_prefsSEXP, SEXP women_prefsSEXP) {
+DataFrame best_gs_bucket_cpp(List men_prefs, List women_prefs, int threads, bool stats);
+RcppExport SEXP _CHTpackage_best_gs_bucket_cpp(SEXP men_prefsSEXP, SEXP women_prefsSEXP, SEXP threadsSEXP, SEXP statsSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
     Rcpp::traits::input_parameter< List >::type men_prefs(men_prefsSEXP);
     Rcpp::traits::input_parameter< List >::type women_prefs(women_prefsSEXP);
-    rcpp_result_gen = Rcpp::wrap(best_gs_bucket_cpp(men_prefs, women_prefs));
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< bool >::type stats(statsSEXP);
+    rcpp_result_gen = Rcpp::wrap(best_gs_bucket_cpp(men_prefs, women_prefs, threads, stats));
+    return rcpp_result_gen;
+END_RCPP
+}
+// best_gs_bucket_matrix_cpp
+DataFrame best_gs_bucket_matrix_cpp(IntegerMatrix men_prefs, IntegerMatrix women_prefs, std::string by, bool women_ranks, Nullable<CharacterVector> men_names, Nullable<CharacterVector> women_names);
+RcppExport SEXP _CHTpackage_best_gs_bucket_matrix_cpp(SEXP men_prefsSEXP, SEXP women_prefsSEXP, SEXP bySEXP, SEXP women_ranksSEXP, SEXP men_namesSEXP, SEXP women_namesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< IntegerMatrix >::type men_prefs(men_prefsSEXP);
+    Rcpp::traits::input_parameter< IntegerMatrix >::type women_prefs(women_prefsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
+    Rcpp::traits::input_parameter< bool >::type women_ranks(women_ranksSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type men_names(men_namesSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type women_names(women_namesSEXP);
+    rcpp_result_gen = Rcpp::wrap(best_gs_bucket_matrix_cpp(men_prefs, women_prefs, by, women_ranks, men_names, women_names));
+    return rcpp_result_gen;
+END_RCPP
+}
+// best_gs_bucket_batch_cpp
+DataFrame best_gs_bucket_batch_cpp(SEXP men_prefs, SEXP women_prefs, int threads, std::string by, bool women_ranks);
+RcppExport SEXP _CHTpackage_best_gs_bucket_batch_cpp(SEXP men_prefsSEXP, SEXP women_prefsSEXP, SEXP threadsSEXP, SEXP bySEXP, SEXP women_ranksSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type men_prefs(men_prefsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type women_prefs(women_prefsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type by(bySEXP);
+    Rcpp::traits::input_parameter< bool >::type women_ranks(women_ranksSEXP);
+    rcpp_result_gen = Rcpp::wrap(best_gs_bucket_batch_cpp(men_prefs, women_prefs, threads, by, women_ranks));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gs_bucket_scaling_cpp
+DataFrame gs_bucket_scaling_cpp(IntegerVector sizes, int reps, int seed);
+RcppExport SEXP _CHTpackage_gs_bucket_scaling_cpp(SEXP sizesSEXP, SEXP repsSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< IntegerVector >::type sizes(sizesSEXP);
+    Rcpp::traits::input_parameter< int >::type reps(repsSEXP);
+    Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(gs_bucket_scaling_cpp(sizes, reps, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// hospitals_residents_cpp
+DataFrame hospitals_residents_cpp(List applicant_prefs, List site_prefs, IntegerVector capacities);
+RcppExport SEXP _CHTpackage_hospitals_residents_cpp(SEXP applicant_prefsSEXP, SEXP site_prefsSEXP, SEXP capacitiesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type applicant_prefs(applicant_prefsSEXP);
+    Rcpp::traits::input_parameter< List >::type site_prefs(site_prefsSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type capacities(capacitiesSEXP);
+    rcpp_result_gen = Rcpp::wrap(hospitals_residents_cpp(applicant_prefs, site_prefs, capacities));
+    return rcpp_result_gen;
+END_RCPP
+}
+// hr_bucket_scaling_cpp
+DataFrame hr_bucket_scaling_cpp(int n_applicants, int n_sites, int list_length, int seed);
+RcppExport SEXP _CHTpackage_hr_bucket_scaling_cpp(SEXP n_applicantsSEXP, SEXP n_sitesSEXP, SEXP list_lengthSEXP, SEXP seedSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type n_applicants(n_applicantsSEXP);
+    Rcpp::traits::input_parameter< int >::type n_sites(n_sitesSEXP);
+    Rcpp::traits::input_parameter< int >::type list_length(list_lengthSEXP);
+    Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
+    rcpp_result_gen = Rcpp::wrap(hr_bucket_scaling_cpp(n_applicants, n_sites, list_length, seed));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gs_pref_file_write_cpp
+double gs_pref_file_write_cpp(std::string path, SEXP men_prefs, SEXP women_prefs);
+RcppExport SEXP _CHTpackage_gs_pref_file_write_cpp(SEXP pathSEXP, SEXP men_prefsSEXP, SEXP women_prefsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type men_prefs(men_prefsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type women_prefs(women_prefsSEXP);
+    rcpp_result_gen = Rcpp::wrap(gs_pref_file_write_cpp(path, men_prefs, women_prefs));
+    return rcpp_result_gen;
+END_RCPP
+}
+// best_gs_bucket_file_cpp
+DataFrame best_gs_bucket_file_cpp(std::string path, Nullable<CharacterVector> rank_file);
+RcppExport SEXP _CHTpackage_best_gs_bucket_file_cpp(SEXP pathSEXP, SEXP rank_fileSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< std::string >::type path(pathSEXP);
+    Rcpp::traits::input_parameter< Nullable<CharacterVector> >::type rank_file(rank_fileSEXP);
+    rcpp_result_gen = Rcpp::wrap(best_gs_bucket_file_cpp(path, rank_file));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gs_incremental_new
+SEXP gs_incremental_new(List men_prefs, List women_prefs);
+RcppExport SEXP _CHTpackage_gs_incremental_new(SEXP men_prefsSEXP, SEXP women_prefsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type men_prefs(men_prefsSEXP);
+    Rcpp::traits::input_parameter< List >::type women_prefs(women_prefsSEXP);
+    rcpp_result_gen = Rcpp::wrap(gs_incremental_new(men_prefs, women_prefs));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gs_incremental_add_agent
+double gs_incremental_add_agent(SEXP solver, std::string side, std::string name, CharacterVector prefs);
+RcppExport SEXP _CHTpackage_gs_incremental_add_agent(SEXP solverSEXP, SEXP sideSEXP, SEXP nameSEXP, SEXP prefsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type solver(solverSEXP);
+    Rcpp::traits::input_parameter< std::string >::type side(sideSEXP);
+    Rcpp::traits::input_parameter< std::string >::type name(nameSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type prefs(prefsSEXP);
+    rcpp_result_gen = Rcpp::wrap(gs_incremental_add_agent(solver, side, name, prefs));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gs_incremental_remove_agent
+double gs_incremental_remove_agent(SEXP solver, std::string side, std::string name);
+RcppExport SEXP _CHTpackage_gs_incremental_remove_agent(SEXP solverSEXP, SEXP sideSEXP, SEXP nameSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type solver(solverSEXP);
+    Rcpp::traits::input_parameter< std::string >::type side(sideSEXP);
+    Rcpp::traits::input_parameter< std::string >::type name(nameSEXP);
+    rcpp_result_gen = Rcpp::wrap(gs_incremental_remove_agent(solver, side, name));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gs_incremental_update_prefs
+double gs_incremental_update_prefs(SEXP solver, std::string side, std::string name, CharacterVector prefs);
+RcppExport SEXP _CHTpackage_gs_incremental_update_prefs(SEXP solverSEXP, SEXP sideSEXP, SEXP nameSEXP, SEXP prefsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type solver(solverSEXP);
+    Rcpp::traits::input_parameter< std::string >::type side(sideSEXP);
+    Rcpp::traits::input_parameter< std::string >::type name(nameSEXP);
+    Rcpp::traits::input_parameter< CharacterVector >::type prefs(prefsSEXP);
+    rcpp_result_gen = Rcpp::wrap(gs_incremental_update_prefs(solver, side, name, prefs));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gs_incremental_matching
+DataFrame gs_incremental_matching(SEXP solver);
+RcppExport SEXP _CHTpackage_gs_incremental_matching(SEXP solverSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type solver(solverSEXP);
+    rcpp_result_gen = Rcpp::wrap(gs_incremental_matching(solver));
+    return rcpp_result_gen;
+END_RCPP
+}
+// stable_matchings_cpp
+List stable_matchings_cpp(List men_prefs, List women_prefs);
+RcppExport SEXP _CHTpackage_stable_matchings_cpp(SEXP men_prefsSEXP, SEXP women_prefsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< List >::type men_prefs(men_prefsSEXP);
+    Rcpp::traits::input_parameter< List >::type women_prefs(women_prefsSEXP);
+    rcpp_result_gen = Rcpp::wrap(stable_matchings_cpp(men_prefs, women_prefs));
+    return rcpp_result_gen;
+END_RCPP
+}
+// verify_stable_matching_cpp
+List verify_stable_matching_cpp(SEXP men_prefs, SEXP women_prefs, DataFrame matching, Nullable<DataFrame> reference, int threads);
+RcppExport SEXP _CHTpackage_verify_stable_matching_cpp(SEXP men_prefsSEXP, SEXP women_prefsSEXP, SEXP matchingSEXP, SEXP referenceSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type men_prefs(men_prefsSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type women_prefs(women_prefsSEXP);
+    Rcpp::traits::input_parameter< DataFrame >::type matching(matchingSEXP);
+    Rcpp::traits::input_parameter< Nullable<DataFrame> >::type reference(referenceSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(verify_stable_matching_cpp(men_prefs, women_prefs, matching, reference, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// gs_workspace_new
+SEXP gs_workspace_new();
+RcppExport SEXP _CHTpackage_gs_workspace_new() {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    rcpp_result_gen = Rcpp::wrap(gs_workspace_new());
+    return rcpp_result_gen;
+END_RCPP
+}
+// gs_workspace_solve
+DataFrame gs_workspace_solve(SEXP workspace, List men_prefs, List women_prefs, std::string algorithm);
+RcppExport SEXP _CHTpackage_gs_workspace_solve(SEXP workspaceSEXP, SEXP men_prefsSEXP, SEXP women_prefsSEXP, SEXP algorithmSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type workspace(workspaceSEXP);
+    Rcpp::traits::input_parameter< List >::type men_prefs(men_prefsSEXP);
+    Rcpp::traits::input_parameter< List >::type women_prefs(women_prefsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type algorithm(algorithmSEXP);
+    rcpp_result_gen = Rcpp::wrap(gs_workspace_solve(workspace, men_prefs, women_prefs, algorithm));
     return rcpp_result_gen;
 END_RCPP
 }
@@ -49,27 +263,224 @@ BEGIN_RCPP
     return rcpp_result_gen;
 END_RCPP
 }
+// build_antigen_graph_cpp
+List build_antigen_graph_cpp(SEXP donor_antigens, SEXP receiver_antibodies, int threads);
+RcppExport SEXP _CHTpackage_build_antigen_graph_cpp(SEXP donor_antigensSEXP, SEXP receiver_antibodiesSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type donor_antigens(donor_antigensSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type receiver_antibodies(receiver_antibodiesSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(build_antigen_graph_cpp(donor_antigens, receiver_antibodies, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
 // hopcroft_karp_cpp
-List hopcroft_karp_cpp(const IntegerVector& donors, const IntegerVector& receivers, const DataFrame& data, const NumericMatrix& compatibility_table, const CharacterVector& blood_types);
-RcppExport SEXP _CHTpackage_hopcroft_karp_cpp(SEXP donorsSEXP, SEXP receiversSEXP, SEXP dataSEXP, SEXP compatibility_tableSEXP, SEXP blood_typesSEXP) {
+List hopcroft_karp_cpp(const IntegerVector& donors, const IntegerVector& receivers, const DataFrame& data, const NumericMatrix& compatibility_table, const CharacterVector& blood_types, std::string method, std::string warm_start, Nullable<IntegerVector> initial, bool compare_cold, int threads, std::string output, Nullable<LogicalVector> return_graph, bool stats);
+RcppExport SEXP _CHTpackage_hopcroft_karp_cpp(SEXP donorsSEXP, SEXP receiversSEXP, SEXP dataSEXP, SEXP compatibility_tableSEXP, SEXP blood_typesSEXP, SEXP methodSEXP, SEXP warm_startSEXP, SEXP initialSEXP, SEXP compare_coldSEXP, SEXP threadsSEXP, SEXP outputSEXP, SEXP return_graphSEXP, SEXP statsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const IntegerVector& >::type donors(donorsSEXP);
+    Rcpp::traits::input_parameter< const IntegerVector& >::type receivers(receiversSEXP);
+    Rcpp::traits::input_parameter< const DataFrame& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< const NumericMatrix& >::type compatibility_table(compatibility_tableSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector& >::type blood_types(blood_typesSEXP);
+    Rcpp::traits::input_parameter< std::string >::type method(methodSEXP);
+    Rcpp::traits::input_parameter< std::string >::type warm_start(warm_startSEXP);
+    Rcpp::traits::input_parameter< Nullable<IntegerVector> >::type initial(initialSEXP);
+    Rcpp::traits::input_parameter< bool >::type compare_cold(compare_coldSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type output(outputSEXP);
+    Rcpp::traits::input_parameter< Nullable<LogicalVector> >::type return_graph(return_graphSEXP);
+    Rcpp::traits::input_parameter< bool >::type stats(statsSEXP);
+    rcpp_result_gen = Rcpp::wrap(hopcroft_karp_cpp(donors, receivers, data, compatibility_table, blood_types, method, warm_start, initial, compare_cold, threads, output, return_graph, stats));
+    return rcpp_result_gen;
+END_RCPP
+}
+// hk_verify_maximum_cpp
+List hk_verify_maximum_cpp(const List& result, const IntegerVector& donors, const IntegerVector& receivers, const DataFrame& data, const NumericMatrix& compatibility_table, const CharacterVector& blood_types);
+RcppExport SEXP _CHTpackage_hk_verify_maximum_cpp(SEXP resultSEXP, SEXP donorsSEXP, SEXP receiversSEXP, SEXP dataSEXP, SEXP compatibility_tableSEXP, SEXP blood_typesSEXP) {
 BEGIN_RCPP
     Rcpp::RObject rcpp_result_gen;
     Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const List& >::type result(resultSEXP);
     Rcpp::traits::input_parameter< const IntegerVector& >::type donors(donorsSEXP);
     Rcpp::traits::input_parameter< const IntegerVector& >::type receivers(receiversSEXP);
     Rcpp::traits::input_parameter< const DataFrame& >::type data(dataSEXP);
     Rcpp::traits::input_parameter< const NumericMatrix& >::type compatibility_table(compatibility_tableSEXP);
     Rcpp::traits::input_parameter< const CharacterVector& >::type blood_types(blood_typesSEXP);
-    rcpp_result_gen = Rcpp::wrap(hopcroft_karp_cpp(donors, receivers, data, compatibility_table, blood_types));
+    rcpp_result_gen = Rcpp::wrap(hk_verify_maximum_cpp(result, donors, receivers, data, compatibility_table, blood_types));
+    return rcpp_result_gen;
+END_RCPP
+}
+// hk_thread_scaling_cpp
+DataFrame hk_thread_scaling_cpp(const IntegerVector& donors, const IntegerVector& receivers, const DataFrame& data, const NumericMatrix& compatibility_table, const CharacterVector& blood_types, IntegerVector threads, int reps);
+RcppExport SEXP _CHTpackage_hk_thread_scaling_cpp(SEXP donorsSEXP, SEXP receiversSEXP, SEXP dataSEXP, SEXP compatibility_tableSEXP, SEXP blood_typesSEXP, SEXP threadsSEXP, SEXP repsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const IntegerVector& >::type donors(donorsSEXP);
+    Rcpp::traits::input_parameter< const IntegerVector& >::type receivers(receiversSEXP);
+    Rcpp::traits::input_parameter< const DataFrame& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< const NumericMatrix& >::type compatibility_table(compatibility_tableSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector& >::type blood_types(blood_typesSEXP);
+    Rcpp::traits::input_parameter< IntegerVector >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type reps(repsSEXP);
+    rcpp_result_gen = Rcpp::wrap(hk_thread_scaling_cpp(donors, receivers, data, compatibility_table, blood_types, threads, reps));
+    return rcpp_result_gen;
+END_RCPP
+}
+// min_cost_assignment_cpp
+List min_cost_assignment_cpp(const List& graph, SEXP costs, int threads, Nullable<NumericVector> unmatched_cost, double tolerance);
+RcppExport SEXP _CHTpackage_min_cost_assignment_cpp(SEXP graphSEXP, SEXP costsSEXP, SEXP threadsSEXP, SEXP unmatched_costSEXP, SEXP toleranceSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const List& >::type graph(graphSEXP);
+    Rcpp::traits::input_parameter< SEXP >::type costs(costsSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< Nullable<NumericVector> >::type unmatched_cost(unmatched_costSEXP);
+    Rcpp::traits::input_parameter< double >::type tolerance(toleranceSEXP);
+    rcpp_result_gen = Rcpp::wrap(min_cost_assignment_cpp(graph, costs, threads, unmatched_cost, tolerance));
+    return rcpp_result_gen;
+END_RCPP
+}
+// hk_online_new
+SEXP hk_online_new(const NumericMatrix& compatibility_table, const CharacterVector& blood_types);
+RcppExport SEXP _CHTpackage_hk_online_new(SEXP compatibility_tableSEXP, SEXP blood_typesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const NumericMatrix& >::type compatibility_table(compatibility_tableSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector& >::type blood_types(blood_typesSEXP);
+    rcpp_result_gen = Rcpp::wrap(hk_online_new(compatibility_table, blood_types));
+    return rcpp_result_gen;
+END_RCPP
+}
+// hk_online_add
+int hk_online_add(SEXP matcher, std::string side, const IntegerVector& ids, const CharacterVector& blood_type);
+RcppExport SEXP _CHTpackage_hk_online_add(SEXP matcherSEXP, SEXP sideSEXP, SEXP idsSEXP, SEXP blood_typeSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type matcher(matcherSEXP);
+    Rcpp::traits::input_parameter< std::string >::type side(sideSEXP);
+    Rcpp::traits::input_parameter< const IntegerVector& >::type ids(idsSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector& >::type blood_type(blood_typeSEXP);
+    rcpp_result_gen = Rcpp::wrap(hk_online_add(matcher, side, ids, blood_type));
+    return rcpp_result_gen;
+END_RCPP
+}
+// hk_online_remove
+int hk_online_remove(SEXP matcher, std::string side, const IntegerVector& ids);
+RcppExport SEXP _CHTpackage_hk_online_remove(SEXP matcherSEXP, SEXP sideSEXP, SEXP idsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type matcher(matcherSEXP);
+    Rcpp::traits::input_parameter< std::string >::type side(sideSEXP);
+    Rcpp::traits::input_parameter< const IntegerVector& >::type ids(idsSEXP);
+    rcpp_result_gen = Rcpp::wrap(hk_online_remove(matcher, side, ids));
+    return rcpp_result_gen;
+END_RCPP
+}
+// hk_online_matching
+DataFrame hk_online_matching(SEXP matcher);
+RcppExport SEXP _CHTpackage_hk_online_matching(SEXP matcherSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< SEXP >::type matcher(matcherSEXP);
+    rcpp_result_gen = Rcpp::wrap(hk_online_matching(matcher));
+    return rcpp_result_gen;
+END_RCPP
+}
+// generate_preferences_cpp
+List generate_preferences_cpp(int n, std::string family, int list_length, double correlation, int seed, int threads, std::string output);
+RcppExport SEXP _CHTpackage_generate_preferences_cpp(SEXP nSEXP, SEXP familySEXP, SEXP list_lengthSEXP, SEXP correlationSEXP, SEXP seedSEXP, SEXP threadsSEXP, SEXP outputSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type n(nSEXP);
+    Rcpp::traits::input_parameter< std::string >::type family(familySEXP);
+    Rcpp::traits::input_parameter< int >::type list_length(list_lengthSEXP);
+    Rcpp::traits::input_parameter< double >::type correlation(correlationSEXP);
+    Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< std::string >::type output(outputSEXP);
+    rcpp_result_gen = Rcpp::wrap(generate_preferences_cpp(n, family, list_length, correlation, seed, threads, output));
+    return rcpp_result_gen;
+END_RCPP
+}
+// generate_blood_population_cpp
+List generate_blood_population_cpp(int n_donors, int n_receivers, Nullable<NumericVector> frequencies, int seed, int threads);
+RcppExport SEXP _CHTpackage_generate_blood_population_cpp(SEXP n_donorsSEXP, SEXP n_receiversSEXP, SEXP frequenciesSEXP, SEXP seedSEXP, SEXP threadsSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< int >::type n_donors(n_donorsSEXP);
+    Rcpp::traits::input_parameter< int >::type n_receivers(n_receiversSEXP);
+    Rcpp::traits::input_parameter< Nullable<NumericVector> >::type frequencies(frequenciesSEXP);
+    Rcpp::traits::input_parameter< int >::type seed(seedSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    rcpp_result_gen = Rcpp::wrap(generate_blood_population_cpp(n_donors, n_receivers, frequencies, seed, threads));
+    return rcpp_result_gen;
+END_RCPP
+}
+// kidney_exchange_cpp
+List kidney_exchange_cpp(const IntegerVector& donors, const IntegerVector& patients, const DataFrame& data, const NumericMatrix& compatibility_table, const CharacterVector& blood_types, int max_length, int threads, int node_limit, int max_cycles);
+RcppExport SEXP _CHTpackage_kidney_exchange_cpp(SEXP donorsSEXP, SEXP patientsSEXP, SEXP dataSEXP, SEXP compatibility_tableSEXP, SEXP blood_typesSEXP, SEXP max_lengthSEXP, SEXP threadsSEXP, SEXP node_limitSEXP, SEXP max_cyclesSEXP) {
+BEGIN_RCPP
+    Rcpp::RObject rcpp_result_gen;
+    Rcpp::RNGScope rcpp_rngScope_gen;
+    Rcpp::traits::input_parameter< const IntegerVector& >::type donors(donorsSEXP);
+    Rcpp::traits::input_parameter< const IntegerVector& >::type patients(patientsSEXP);
+    Rcpp::traits::input_parameter< const DataFrame& >::type data(dataSEXP);
+    Rcpp::traits::input_parameter< const NumericMatrix& >::type compatibility_table(compatibility_tableSEXP);
+    Rcpp::traits::input_parameter< const CharacterVector& >::type blood_types(blood_typesSEXP);
+    Rcpp::traits::input_parameter< int >::type max_length(max_lengthSEXP);
+    Rcpp::traits::input_parameter< int >::type threads(threadsSEXP);
+    Rcpp::traits::input_parameter< int >::type node_limit(node_limitSEXP);
+    Rcpp::traits::input_parameter< int >::type max_cycles(max_cyclesSEXP);
+    rcpp_result_gen = Rcpp::wrap(kidney_exchange_cpp(donors, patients, data, compatibility_table, blood_types, max_length, threads, node_limit, max_cycles));
     return rcpp_result_gen;
 END_RCPP
 }
 
 static const R_CallMethodDef CallEntries[] = {
-    {"_CHTpackage_gale_shapley_cpp", (DL_FUNC) &_CHTpackage_gale_shapley_cpp, 2},
-    {"_CHTpackage_best_gs_bucket_cpp", (DL_FUNC) &_CHTpackage_best_gs_bucket_cpp, 2},
+    {"_CHTpackage_gale_shapley_cpp", (DL_FUNC) &_CHTpackage_gale_shapley_cpp, 3},
+    {"_CHTpackage_best_gs_bucket_cpp", (DL_FUNC) &_CHTpackage_best_gs_bucket_cpp, 4},
+    {"_CHTpackage_best_gs_bucket_matrix_cpp", (DL_FUNC) &_CHTpackage_best_gs_bucket_matrix_cpp, 6},
+    {"_CHTpackage_best_gs_bucket_batch_cpp", (DL_FUNC) &_CHTpackage_best_gs_bucket_batch_cpp, 5},
+    {"_CHTpackage_gs_bucket_scaling_cpp", (DL_FUNC) &_CHTpackage_gs_bucket_scaling_cpp, 3},
+    {"_CHTpackage_hospitals_residents_cpp", (DL_FUNC) &_CHTpackage_hospitals_residents_cpp, 3},
+    {"_CHTpackage_hr_bucket_scaling_cpp", (DL_FUNC) &_CHTpackage_hr_bucket_scaling_cpp, 4},
+    {"_CHTpackage_gs_pref_file_write_cpp", (DL_FUNC) &_CHTpackage_gs_pref_file_write_cpp, 3},
+    {"_CHTpackage_best_gs_bucket_file_cpp", (DL_FUNC) &_CHTpackage_best_gs_bucket_file_cpp, 2},
+    {"_CHTpackage_gs_incremental_new", (DL_FUNC) &_CHTpackage_gs_incremental_new, 2},
+    {"_CHTpackage_gs_incremental_add_agent", (DL_FUNC) &_CHTpackage_gs_incremental_add_agent, 4},
+    {"_CHTpackage_gs_incremental_remove_agent", (DL_FUNC) &_CHTpackage_gs_incremental_remove_agent, 3},
+    {"_CHTpackage_gs_incremental_update_prefs", (DL_FUNC) &_CHTpackage_gs_incremental_update_prefs, 4},
+    {"_CHTpackage_gs_incremental_matching", (DL_FUNC) &_CHTpackage_gs_incremental_matching, 1},
+    {"_CHTpackage_stable_matchings_cpp", (DL_FUNC) &_CHTpackage_stable_matchings_cpp, 2},
+    {"_CHTpackage_verify_stable_matching_cpp", (DL_FUNC) &_CHTpackage_verify_stable_matching_cpp, 5},
+    {"_CHTpackage_gs_workspace_new", (DL_FUNC) &_CHTpackage_gs_workspace_new, 0},
+    {"_CHTpackage_gs_workspace_solve", (DL_FUNC) &_CHTpackage_gs_workspace_solve, 4},
     {"_CHTpackage_build_compatibility_graph_cpp", (DL_FUNC) &_CHTpackage_build_compatibility_graph_cpp, 5},
-    {"_CHTpackage_hopcroft_karp_cpp", (DL_FUNC) &_CHTpackage_hopcroft_karp_cpp, 5},
+    {"_CHTpackage_build_antigen_graph_cpp", (DL_FUNC) &_CHTpackage_build_antigen_graph_cpp, 3},
+    {"_CHTpackage_hopcroft_karp_cpp", (DL_FUNC) &_CHTpackage_hopcroft_karp_cpp, 13},
+    {"_CHTpackage_hk_verify_maximum_cpp", (DL_FUNC) &_CHTpackage_hk_verify_maximum_cpp, 6},
+    {"_CHTpackage_hk_thread_scaling_cpp", (DL_FUNC) &_CHTpackage_hk_thread_scaling_cpp, 7},
+    {"_CHTpackage_min_cost_assignment_cpp", (DL_FUNC) &_CHTpackage_min_cost_assignment_cpp, 5},
+    {"_CHTpackage_hk_online_new", (DL_FUNC) &_CHTpackage_hk_online_new, 2},
+    {"_CHTpackage_hk_online_add", (DL_FUNC) &_CHTpackage_hk_online_add, 4},
+    {"_CHTpackage_hk_online_remove", (DL_FUNC) &_CHTpackage_hk_online_remove, 3},
+    {"_CHTpackage_hk_online_matching", (DL_FUNC) &_CHTpackage_hk_online_matching, 1},
+    {"_CHTpackage_generate_preferences_cpp", (DL_FUNC) &_CHTpackage_generate_preferences_cpp, 7},
+    {"_CHTpackage_generate_blood_population_cpp", (DL_FUNC) &_CHTpackage_generate_blood_population_cpp, 5},
+    {"_CHTpackage_kidney_exchange_cpp", (DL_FUNC) &_CHTpackage_kidney_exchange_cpp, 9},
     {NULL, NULL, 0}
 };
 
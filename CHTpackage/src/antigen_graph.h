@@ -0,0 +1,117 @@
+// Compatibility graph from antigen / antibody bitmasks.
+//
+// Each donor carries a set of antigens and each recipient a set of
+// antibodies over the same panel (ABO and RhD, but also Kell, Duffy, Kidd,
+// HLA...). A donor may give to a recipient iff no donor antigen meets a
+// recipient antibody:
+//   (donor_antigens & recipient_antibodies) == 0, word by word.
+// Panels wider than 64 antigens take several 64-bit words per agent.
+//
+// The builder works on bitsets rather than pair by pair. For every antigen
+// k, the recipients that carry the matching antibody form a bitset over
+// recipients; the recipients a donor cannot give to are then the OR of the
+// bitsets of its antigens, and its row is the complement. A donor with a
+// antigens costs a * R / 64 word operations, so 64 pairs are tested per
+// operation, in plain loops over words that the compiler vectorises.
+// Donors with the same antigens share one row, computed once (panels are
+// small, so there are few distinct donor masks). Rows are computed in
+// parallel, over blocks of recipients that stay in cache, and written
+// straight into the CSR arrays of a BipartiteGraph.
+#ifndef CHT_ANTIGEN_GRAPH_H
+#define CHT_ANTIGEN_GRAPH_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "bipartite_matching.h"
+#include "worker_pool.h"
+
+// donor_antigens holds n_words words per donor (row-major), likewise
+// recipient_antibodies per recipient. Neighbours keep the order of the
+// recipients.
+inline void build_antigen_graph(const std::vector<uint64_t>& donor_antigens,
+                                const std::vector<uint64_t>& recipient_antibodies, int n_words,
+                                WorkerPool& pool, BipartiteGraph& graph) {
+  const std::size_t W = n_words;
+  const int D = W == 0 ? 0 : (int)(donor_antigens.size() / W);
+  const int R = W == 0 ? 0 : (int)(recipient_antibodies.size() / W);
+  graph.n_left = D;
+  graph.n_right = R;
+  graph.start.assign(D + 1, 0);
+  graph.adj.clear();
+  if (D == 0) return;
+
+  // blocked[k * n_words_r + i]: bit j set if recipient 64 i + j carries
+  // the antibody against antigen k
+  const std::size_t n_antigens = 64 * W;
+  const std::size_t n_words_r = (R + 63) / 64;
+  std::vector<uint64_t> blocked(n_antigens * n_words_r, 0);
+  for (int r = 0; r < R; r++) {
+    for (std::size_t w = 0; w < W; w++) {
+      uint64_t antibodies = recipient_antibodies[r * W + w];
+      while (antibodies) {
+        std::size_t k = 64 * w + __builtin_ctzll(antibodies);
+        antibodies &= antibodies - 1;
+        blocked[k * n_words_r + r / 64] |= uint64_t(1) << (r % 64);
+      }
+    }
+  }
+
+  // Distinct donor masks: donors sorted by mask, one row per run of equal
+  // masks
+  auto mask = [&](int d) { return donor_antigens.data() + d * W; };
+  std::vector<int> order(D);
+  for (int d = 0; d < D; d++) order[d] = d;
+  std::sort(order.begin(), order.end(), [&](int a, int b) {
+    return std::lexicographical_compare(mask(a), mask(a) + W, mask(b), mask(b) + W);
+  });
+  std::vector<int> row_of(D), representative;
+  for (int i = 0; i < D; i++) {
+    int d = order[i];
+    if (i == 0 || !std::equal(mask(d), mask(d) + W, mask(order[i - 1]))) representative.push_back(d);
+    row_of[d] = (int)representative.size() - 1;
+  }
+
+  // One row per distinct mask. Recipients go by blocks of 64 * block
+  // that stay in cache while every donor of the thread is tested.
+  const std::size_t block = 256;
+  std::vector<std::vector<int>> rows(representative.size());
+  pool.parallel_for(representative.size(), [&](std::size_t begin, std::size_t end, int) {
+    std::vector<uint64_t> clash(block);
+    std::vector<std::size_t> antigens;
+    for (std::size_t first = 0; first < n_words_r; first += block) {
+      const std::size_t n = std::min(block, n_words_r - first);
+      for (std::size_t k = begin; k < end; k++) {
+        const uint64_t* donor = mask(representative[k]);
+        antigens.clear();
+        for (std::size_t w = 0; w < W; w++) {
+          for (uint64_t a = donor[w]; a; a &= a - 1) antigens.push_back(64 * w + __builtin_ctzll(a));
+        }
+        std::fill(clash.begin(), clash.begin() + n, 0);
+        for (std::size_t antigen : antigens) {
+          const uint64_t* bits = blocked.data() + antigen * n_words_r + first;
+          for (std::size_t i = 0; i < n; i++) clash[i] |= bits[i];
+        }
+        std::vector<int>& row = rows[k];
+        for (std::size_t i = 0; i < n; i++) {
+          std::size_t base = 64 * (first + i);
+          uint64_t open = ~clash[i];
+          if (base + 64 > (std::size_t)R) open &= (uint64_t(1) << (R - base)) - 1;
+          for (; open; open &= open - 1) row.push_back((int)(base + __builtin_ctzll(open)));
+        }
+      }
+    }
+  });
+
+  for (int d = 0; d < D; d++) graph.start[d + 1] = graph.start[d] + rows[row_of[d]].size();
+  graph.adj.resize(graph.start[D]);
+  pool.parallel_for(D, [&](std::size_t begin, std::size_t end, int) {
+    for (std::size_t d = begin; d < end; d++) {
+      const std::vector<int>& row = rows[row_of[d]];
+      std::copy(row.begin(), row.end(), graph.adj.begin() + graph.start[d]);
+    }
+  });
+}
+
+#endif
@@ -0,0 +1,344 @@
+// Min-cost bipartite matching by the epsilon-scaling auction algorithm.
+//
+// The donor x receiver graph is sparse and unbalanced, and not every donor
+// can be matched, so it is first turned into a square perfect assignment
+// problem with the same sparsity:
+//   donor i    - receiver j   cost c_ij    (every compatible pair)
+//   donor i    - dummy i      cost M       (i stays unmatched)
+//   slack j    - receiver j   cost 0       (j stays unmatched)
+//   slack j    - dummy i      cost 0       (for every edge i - j)
+// A matching of the original graph extends to a perfect assignment of cost
+// sum(c) + M * (unmatched donors) and conversely. With M larger than any
+// cost difference a matched pair can make, the optimum is a maximum
+// matching of minimum cost; a smaller M trades matches for cost.
+//
+// Bidders (donors and slacks) bid for objects (receivers and dummies) in
+// Jacobi rounds: all free bidders compute their bid against the same
+// prices, each object keeps the highest bid with an atomic maximum, then
+// winners take their objects. When few bidders are left free a round no
+// longer pays for the barrier, and bids are finished one by one
+// (Gauss-Seidel) on the same prices. Epsilon is divided by `scaling` after
+// each pass; prices are kept, and so are the assignments that still satisfy
+// the tighter epsilon, so late passes only re-bid what actually moved.
+// With a final epsilon below tolerance / n the total cost is within
+// tolerance of the optimum (exact for integer costs and tolerance 1).
+//
+// Prices climb to about the largest benefit, and an epsilon below half an
+// ulp of a price no longer moves it: tied bidders would then outbid each
+// other forever. Costs are shifted so the cheapest edge costs 0, the final
+// epsilon is kept at least a few ulps of the benefit range, and every bid
+// raises the price by at least one representable step. With very large
+// costs the tolerance actually reached is therefore looser than asked for;
+// AuctionStats::tolerance reports it.
+#ifndef CHT_AUCTION_ENGINE_H
+#define CHT_AUCTION_ENGINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <vector>
+#include "bipartite_matching.h"
+#include "worker_pool.h"
+
+struct AuctionStats {
+  int scaling_passes = 0;
+  long long bids = 0;
+  double epsilon = 0;    // final epsilon, after the ulp floor
+  double tolerance = 0;  // bound on the distance to the optimal total cost
+};
+
+// Square assignment problem: bidder b may take object arc_object[k] for
+// benefit arc_benefit[k], k in [arc_start[b], arc_start[b+1]).
+struct AuctionProblem {
+  int n = 0;
+  std::vector<int64_t> arc_start;
+  std::vector<int> arc_object;
+  std::vector<double> arc_benefit;
+};
+
+namespace auction_detail {
+
+// Positive doubles order like their bit patterns, which lets an object keep
+// its best bid in one 64-bit atomic.
+inline uint64_t bits(double x) {
+  uint64_t u;
+  std::memcpy(&u, &x, sizeof u);
+  return u;
+}
+
+}  // namespace auction_detail
+
+// Solves the assignment problem (which must have a perfect assignment) for
+// maximum total benefit; fills arc_of_bidder[b] with the arc b holds.
+// epsilon_final is raised to a few ulps of the benefit range if needed.
+inline void auction_solve(const AuctionProblem& problem, double epsilon_final, double scaling,
+                          WorkerPool& pool, std::vector<int64_t>& arc_of_bidder,
+                          AuctionStats* stats = nullptr) {
+  const int n = problem.n;
+  const int n_threads = pool.size();
+  const std::size_t serial_below = 256 * (std::size_t)n_threads;
+  const int none = -1;
+
+  double lowest = 0, highest = 0;
+  for (double a : problem.arc_benefit) {
+    lowest = std::min(lowest, a);
+    highest = std::max(highest, a);
+  }
+  const double range = highest - lowest;
+  epsilon_final = std::max(epsilon_final, std::ldexp(range, -48));
+  // Increment of a bidder with a single arc, where the second best is -inf
+  const double lone_increment = range + epsilon_final;
+
+  std::vector<double> price(n, 0.0);
+  std::vector<int64_t> arc_of(n, none);  // per bidder
+  std::vector<int> bidder_of(n, none);   // per object
+  std::vector<std::atomic<uint64_t>> best_bid(n);
+  std::vector<std::atomic<int>> best_bidder(n);
+  for (int j = 0; j < n; j++) {
+    best_bid[j].store(0, std::memory_order_relaxed);
+    best_bidder[j].store(none, std::memory_order_relaxed);
+  }
+  std::vector<int64_t> bid_arc(n, none);
+  std::vector<double> bid_value(n, 0.0);
+  std::vector<std::vector<int>> next_free(n_threads);
+  std::vector<long long> bid_count(n_threads, 0);
+
+  // Best arc of bidder b at the current prices, and the price it bids
+  auto compute_bid = [&](int b, double epsilon, int64_t& arc, double& amount) {
+    double first = -std::numeric_limits<double>::infinity();
+    double second = first;
+    int64_t best = none;
+    for (int64_t k = problem.arc_start[b]; k < problem.arc_start[b + 1]; k++) {
+      double value = problem.arc_benefit[k] - price[problem.arc_object[k]];
+      if (value > first) {
+        second = first;
+        first = value;
+        best = k;
+      } else if (value > second) {
+        second = value;
+      }
+    }
+    arc = best;
+    const double current = price[problem.arc_object[best]];
+    amount = current + (second == -std::numeric_limits<double>::infinity() ? lone_increment
+                                                                           : first - second + epsilon);
+    amount = std::max(amount, std::nextafter(current, std::numeric_limits<double>::infinity()));
+  };
+
+  // Whether the arc held by b is within epsilon of its best arc
+  auto still_happy = [&](int b, double epsilon) {
+    double first = -std::numeric_limits<double>::infinity();
+    for (int64_t k = problem.arc_start[b]; k < problem.arc_start[b + 1]; k++) {
+      first = std::max(first, problem.arc_benefit[k] - price[problem.arc_object[k]]);
+    }
+    int64_t held = arc_of[b];
+    return problem.arc_benefit[held] - price[problem.arc_object[held]] >= first - epsilon;
+  };
+
+  double epsilon = std::max(range / 2, epsilon_final);
+  int passes = 0;
+  long long serial_bids = 0;
+  std::vector<int> free_bidders;
+  while (true) {
+    passes++;
+    if (passes == 1) {
+      free_bidders.resize(n);
+      for (int b = 0; b < n; b++) free_bidders[b] = b;
+    } else {
+      // Keep the assignments that satisfy the new epsilon
+      for (auto& out : next_free) out.clear();
+      pool.parallel_for(n, [&](std::size_t begin, std::size_t end, int t) {
+        for (std::size_t b = begin; b < end; b++) {
+          if (still_happy((int)b, epsilon)) continue;
+          bidder_of[problem.arc_object[arc_of[b]]] = none;
+          arc_of[b] = none;
+          next_free[t].push_back((int)b);
+        }
+      });
+      free_bidders.clear();
+      for (auto& out : next_free) free_bidders.insert(free_bidders.end(), out.begin(), out.end());
+    }
+
+    while (free_bidders.size() >= serial_below) {
+      // Bids against the same prices; each object keeps the highest one
+      pool.parallel_for(free_bidders.size(), [&](std::size_t begin, std::size_t end, int t) {
+        for (std::size_t i = begin; i < end; i++) {
+          int b = free_bidders[i];
+          int64_t arc;
+          double amount;
+          compute_bid(b, epsilon, arc, amount);
+          int j = problem.arc_object[arc];
+          bid_arc[b] = arc;
+          bid_value[b] = amount;
+          uint64_t key = auction_detail::bits(amount);
+          uint64_t current = best_bid[j].load(std::memory_order_relaxed);
+          while (key > current &&
+                 !best_bid[j].compare_exchange_weak(current, key, std::memory_order_relaxed)) {
+          }
+        }
+        bid_count[t] += end - begin;
+      });
+
+      // One winner per object (the first bidder to claim the best amount)
+      for (auto& out : next_free) out.clear();
+      pool.parallel_for(free_bidders.size(), [&](std::size_t begin, std::size_t end, int t) {
+        std::vector<int>& out = next_free[t];
+        for (std::size_t i = begin; i < end; i++) {
+          int b = free_bidders[i];
+          int j = problem.arc_object[bid_arc[b]];
+          int expected = none;
+          if (auction_detail::bits(bid_value[b]) == best_bid[j].load(std::memory_order_relaxed) &&
+              best_bidder[j].compare_exchange_strong(expected, b, std::memory_order_relaxed)) {
+            int previous = bidder_of[j];
+            if (previous != none) {
+              arc_of[previous] = none;
+              out.push_back(previous);
+            }
+            bidder_of[j] = b;
+            arc_of[b] = bid_arc[b];
+            price[j] = bid_value[b];
+          } else {
+            out.push_back(b);
+          }
+        }
+      });
+
+      // Reset the objects that received bids
+      pool.parallel_for(free_bidders.size(), [&](std::size_t begin, std::size_t end, int) {
+        for (std::size_t i = begin; i < end; i++) {
+          int j = problem.arc_object[bid_arc[free_bidders[i]]];
+          best_bid[j].store(0, std::memory_order_relaxed);
+          best_bidder[j].store(none, std::memory_order_relaxed);
+        }
+      });
+
+      free_bidders.clear();
+      for (auto& out : next_free) free_bidders.insert(free_bidders.end(), out.begin(), out.end());
+    }
+
+    // Serial tail on the same prices
+    while (!free_bidders.empty()) {
+      int b = free_bidders.back();
+      free_bidders.pop_back();
+      int64_t arc;
+      double amount;
+      compute_bid(b, epsilon, arc, amount);
+      serial_bids++;
+      int j = problem.arc_object[arc];
+      int previous = bidder_of[j];
+      if (previous != none) {
+        arc_of[previous] = none;
+        free_bidders.push_back(previous);
+      }
+      bidder_of[j] = b;
+      arc_of[b] = arc;
+      price[j] = amount;
+    }
+
+    if (epsilon <= epsilon_final) break;
+    epsilon = std::max(epsilon / scaling, epsilon_final);
+  }
+
+  arc_of_bidder = arc_of;
+  if (stats) {
+    stats->scaling_passes = passes;
+    stats->bids = serial_bids;
+    for (long long c : bid_count) stats->bids += c;
+    stats->epsilon = epsilon_final;
+  }
+}
+
+// Min-cost matching of graph (cost[k] belongs to graph.adj[k]). A donor
+// left unmatched costs unmatched_cost; an infinite value selects a maximum
+// matching of minimum cost. Fills match_left with the receiver of each
+// donor (or -1), match_edge with the index in graph.adj of the edge held
+// (or -1; a donor may list a receiver twice), and returns the total cost of
+// the matched pairs.
+inline double auction_min_cost_matching(const BipartiteGraph& graph, const std::vector<double>& cost,
+                                        double unmatched_cost, double tolerance, WorkerPool& pool,
+                                        std::vector<int>& match_left, std::vector<int64_t>& match_edge,
+                                        AuctionStats* stats = nullptr) {
+  const int D = graph.n_left, R = graph.n_right;
+  const int n = D + R;
+
+  // Every donor pays either an edge or unmatched_cost, so shifting both by
+  // the cheapest edge changes all totals alike and keeps benefits small
+  double lowest = cost.empty() ? 0 : cost[0], highest = lowest;
+  for (double c : cost) {
+    lowest = std::min(lowest, c);
+    highest = std::max(highest, c);
+  }
+  double unmatched_benefit;
+  if (std::isinf(unmatched_cost)) {
+    // Any extra match must pay off: more than a swing of all matched costs
+    unmatched_benefit = -((double)D * (highest - lowest) + 1 + tolerance);
+  } else {
+    unmatched_benefit = lowest - unmatched_cost;
+  }
+
+  // Transposed adjacency, for the slack - dummy arcs
+  std::vector<int64_t> rstart(R + 1, 0);
+  for (int v : graph.adj) rstart[v + 1]++;
+  for (int v = 0; v < R; v++) rstart[v + 1] += rstart[v];
+  std::vector<int> radj(graph.adj.size());
+  {
+    std::vector<int64_t> fill(rstart.begin(), rstart.end() - 1);
+    for (int u = 0; u < D; u++) {
+      for (int64_t e = graph.start[u]; e < graph.start[u + 1]; e++) radj[fill[graph.adj[e]]++] = u;
+    }
+  }
+
+  // Bidders: donors 0..D-1, slacks D..n-1. Objects: receivers 0..R-1,
+  // dummies R..n-1. Benefits are negated (shifted) costs.
+  AuctionProblem problem;
+  problem.n = n;
+  problem.arc_start.assign(n + 1, 0);
+  const std::size_t n_arcs = 2 * graph.adj.size() + n;
+  problem.arc_object.reserve(n_arcs);
+  problem.arc_benefit.reserve(n_arcs);
+  for (int u = 0; u < D; u++) {
+    for (int64_t e = graph.start[u]; e < graph.start[u + 1]; e++) {
+      problem.arc_object.push_back(graph.adj[e]);
+      problem.arc_benefit.push_back(lowest - cost[e]);
+    }
+    problem.arc_object.push_back(R + u);
+    problem.arc_benefit.push_back(unmatched_benefit);
+    problem.arc_start[u + 1] = problem.arc_object.size();
+  }
+  for (int v = 0; v < R; v++) {
+    problem.arc_object.push_back(v);
+    problem.arc_benefit.push_back(0);
+    for (int64_t e = rstart[v]; e < rstart[v + 1]; e++) {
+      problem.arc_object.push_back(R + radj[e]);
+      problem.arc_benefit.push_back(0);
+    }
+    problem.arc_start[D + v + 1] = problem.arc_object.size();
+  }
+
+  std::vector<int64_t> arc_of;
+  AuctionStats solve_stats;
+  auction_solve(problem, tolerance / (n + 1), 5.0, pool, arc_of, &solve_stats);
+  if (stats) {
+    *stats = solve_stats;
+    stats->tolerance = std::max(tolerance, solve_stats.epsilon * (n + 1));
+  }
+
+  // A donor's arcs are its graph edges (in order) followed by its dummy
+  match_left.assign(D, -1);
+  match_edge.assign(D, -1);
+  double total = 0;
+  for (int u = 0; u < D; u++) {
+    int64_t e = graph.start[u] + (arc_of[u] - problem.arc_start[u]);
+    if (e >= graph.start[u + 1]) continue;
+    match_left[u] = graph.adj[e];
+    match_edge[u] = e;
+    total += cost[e];
+  }
+  return total;
+}
+
+#endif
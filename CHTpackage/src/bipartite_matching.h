@@ -0,0 +1,333 @@
+// Hopcroft-Karp maximum bipartite matching on a CSR adjacency.
+//
+// Left vertices (donors) and right vertices (receivers) are dense ids
+// 0..n-1; the neighbours of left vertex u are adj[start[u] .. start[u+1]).
+// Each phase layers the graph by a BFS from the free left vertices, then
+// augments along vertex-disjoint shortest paths with a DFS that follows the
+// layers and only touches the matching arrays in place, so a run is
+// O(E sqrt(V)) and there is no cap on the number of phases. The DFS keeps
+// its path on an explicit stack: augmenting paths can be as long as the
+// graph, far deeper than the C stack allows.
+//
+// A phase can start from any matching, so a cheap heuristic run first
+// (greedy_matching(), karp_sipser_matching() or a caller's matching) leaves
+// fewer free vertices and usually fewer phases.
+#ifndef CHT_BIPARTITE_MATCHING_H
+#define CHT_BIPARTITE_MATCHING_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "solver_stats.h"
+
+struct BipartiteGraph {
+  int n_left = 0;
+  int n_right = 0;
+  std::vector<int64_t> start;  // n_left + 1 offsets into adj
+  std::vector<int> adj;
+};
+
+// Builds the graph where left u and right v are adjacent iff
+// compatible[left_class[u] * n_classes + right_class[v]] is set; a class of
+// -1 is compatible with nothing. Neighbours keep the order of the right
+// side.
+inline void build_class_graph(int n_classes, const std::vector<char>& compatible,
+                              const std::vector<int>& left_class,
+                              const std::vector<int>& right_class, BipartiteGraph& graph) {
+  graph.n_left = (int)left_class.size();
+  graph.n_right = (int)right_class.size();
+  graph.start.assign(graph.n_left + 1, 0);
+
+  // Degrees first, from the number of right vertices per class
+  std::vector<int64_t> class_size(n_classes, 0);
+  for (int c : right_class) if (c >= 0) class_size[c]++;
+  std::vector<int64_t> class_degree(n_classes, 0);
+  for (int a = 0; a < n_classes; a++) {
+    for (int b = 0; b < n_classes; b++) {
+      if (compatible[(std::size_t)a * n_classes + b]) class_degree[a] += class_size[b];
+    }
+  }
+  for (int u = 0; u < graph.n_left; u++) {
+    int c = left_class[u];
+    graph.start[u + 1] = graph.start[u] + (c >= 0 ? class_degree[c] : 0);
+  }
+
+  graph.adj.resize(graph.start[graph.n_left]);
+  for (int u = 0; u < graph.n_left; u++) {
+    int c = left_class[u];
+    if (c < 0) continue;
+    const char* row = compatible.data() + (std::size_t)c * n_classes;
+    int* out = graph.adj.data() + graph.start[u];
+    for (int v = 0; v < graph.n_right; v++) {
+      int rc = right_class[v];
+      if (rc >= 0 && row[rc]) *out++ = v;
+    }
+  }
+}
+
+// Matches every free left vertex to its first free neighbour, if any.
+// Pairs already in match_left / match_right are kept. Returns the number of
+// new pairs.
+inline int greedy_matching(const BipartiteGraph& graph, std::vector<int>& match_left,
+                           std::vector<int>& match_right) {
+  int added = 0;
+  for (int u = 0; u < graph.n_left; u++) {
+    if (match_left[u] != -1) continue;
+    for (int64_t e = graph.start[u]; e < graph.start[u + 1]; e++) {
+      int v = graph.adj[e];
+      if (match_right[v] == -1) {
+        match_left[u] = v;
+        match_right[v] = u;
+        added++;
+        break;
+      }
+    }
+  }
+  return added;
+}
+
+// Karp-Sipser: a vertex with a single free neighbour is matched to it (this
+// never loses optimality); when none is left, an arbitrary free edge is
+// taken and degrees are updated again. Both sides are tracked, through the
+// transposed adjacency. Pairs already in match_left / match_right are kept.
+// Linear in the size of the graph; returns the number of new pairs.
+inline int karp_sipser_matching(const BipartiteGraph& graph, std::vector<int>& match_left,
+                                std::vector<int>& match_right) {
+  const int n_left = graph.n_left, n_right = graph.n_right;
+
+  // Transposed adjacency
+  std::vector<int64_t> rstart(n_right + 1, 0);
+  for (int v : graph.adj) rstart[v + 1]++;
+  for (int v = 0; v < n_right; v++) rstart[v + 1] += rstart[v];
+  std::vector<int> radj(graph.adj.size());
+  {
+    std::vector<int64_t> fill(rstart.begin(), rstart.end() - 1);
+    for (int u = 0; u < n_left; u++) {
+      for (int64_t e = graph.start[u]; e < graph.start[u + 1]; e++) radj[fill[graph.adj[e]]++] = u;
+    }
+  }
+
+  // Vertices are 0..n_left-1 (left) and n_left..n_left+n_right-1 (right);
+  // degree counts the edges to free vertices of the other side.
+  std::vector<int64_t> degree(n_left + n_right, 0);
+  for (int u = 0; u < n_left; u++) {
+    if (match_left[u] != -1) continue;
+    for (int64_t e = graph.start[u]; e < graph.start[u + 1]; e++) {
+      int v = graph.adj[e];
+      if (match_right[v] == -1) {
+        degree[u]++;
+        degree[n_left + v]++;
+      }
+    }
+  }
+  auto is_free = [&](int x) {
+    return x < n_left ? match_left[x] == -1 : match_right[x - n_left] == -1;
+  };
+  auto neighbours = [&](int x, int64_t& begin, int64_t& end) -> const int* {
+    if (x < n_left) {
+      begin = graph.start[x];
+      end = graph.start[x + 1];
+      return graph.adj.data();
+    }
+    begin = rstart[x - n_left];
+    end = rstart[x - n_left + 1];
+    return radj.data();
+  };
+
+  std::vector<int> degree_one;
+  for (int x = 0; x < n_left + n_right; x++) {
+    if (degree[x] == 1) degree_one.push_back(x);
+  }
+
+  // Matches u - v and removes both from the degrees of their free neighbours
+  auto match = [&](int u, int v) {
+    match_left[u] = v;
+    match_right[v] = u;
+    for (int x : {u, n_left + v}) {
+      int64_t begin, end;
+      const int* list = neighbours(x, begin, end);
+      int offset = x < n_left ? n_left : 0;
+      for (int64_t e = begin; e < end; e++) {
+        int y = list[e] + offset;
+        if (is_free(y) && --degree[y] == 1) degree_one.push_back(y);
+      }
+    }
+  };
+
+  int added = 0;
+  int next_left = 0;
+  while (true) {
+    while (!degree_one.empty()) {
+      int x = degree_one.back();
+      degree_one.pop_back();
+      if (!is_free(x) || degree[x] != 1) continue;
+      int64_t begin, end;
+      const int* list = neighbours(x, begin, end);
+      int offset = x < n_left ? n_left : 0;
+      for (int64_t e = begin; e < end; e++) {
+        int y = list[e] + offset;
+        if (!is_free(y)) continue;
+        if (x < n_left) match(x, y - n_left);
+        else match(y, x - n_left);
+        added++;
+        break;
+      }
+    }
+
+    // No degree-one vertex left: take any free edge
+    while (next_left < n_left && (match_left[next_left] != -1 || degree[next_left] == 0)) next_left++;
+    if (next_left == n_left) break;
+    int u = next_left;
+    for (int64_t e = graph.start[u]; e < graph.start[u + 1]; e++) {
+      int v = graph.adj[e];
+      if (match_right[v] == -1) {
+        match(u, v);
+        added++;
+        break;
+      }
+    }
+  }
+  return added;
+}
+
+class HopcroftKarp {
+public:
+  // Fills match_left[u] with the right partner of u (or -1), match_right
+  // likewise, and returns the matching size.
+  int solve(const BipartiteGraph& graph, std::vector<int>& match_left, std::vector<int>& match_right) {
+    NullStats stats;
+    return solve(graph, match_left, match_right, stats);
+  }
+
+  template <typename Stats>
+  int solve(const BipartiteGraph& graph, std::vector<int>& match_left, std::vector<int>& match_right,
+            Stats& stats) {
+    match_left.assign(graph.n_left, -1);
+    match_right.assign(graph.n_right, -1);
+    return augment(graph, match_left, match_right, stats);
+  }
+
+  // Same as solve(), starting from the (valid) matching already in
+  // match_left / match_right.
+  int augment(const BipartiteGraph& graph, std::vector<int>& match_left, std::vector<int>& match_right) {
+    NullStats stats;
+    return augment(graph, match_left, match_right, stats);
+  }
+
+  // Same, reporting every phase to stats (see solver_stats.h). The BFS that
+  // finds no more paths is not a phase.
+  template <typename Stats>
+  int augment(const BipartiteGraph& graph, std::vector<int>& match_left, std::vector<int>& match_right,
+              Stats& stats) {
+    graph_ = &graph;
+    match_left_ = match_left.data();
+    match_right_ = match_right.data();
+    dist_.assign(graph.n_left, 0);
+    it_.assign(graph.n_left, 0);
+    phases_ = 0;
+
+    int size = 0;
+    for (int u = 0; u < graph.n_left; u++) size += match_left[u] != -1;
+    while (true) {
+      stats.phase_begin();
+      if (!bfs()) break;
+      phases_++;
+      int paths = 0;
+      for (int u = 0; u < graph.n_left; u++) it_[u] = graph.start[u];
+      for (int u = 0; u < graph.n_left; u++) {
+        if (match_left_[u] == -1 && dfs(u)) paths++;
+      }
+      // Every path of the phase has free_layer_ donors
+      stats.phase_end(2 * free_layer_ - 1, paths);
+      size += paths;
+    }
+    return size;
+  }
+
+  // Number of phases (BFS layerings that found an augmenting path) of the
+  // last solve() or augment().
+  int phases() const { return phases_; }
+
+private:
+  static constexpr int unreached = -1;
+
+  // Layers from the free left vertices; true if some free right vertex is
+  // reachable. Layers past the first free right vertex are not explored.
+  bool bfs() {
+    const BipartiteGraph& g = *graph_;
+    queue_.clear();
+    for (int u = 0; u < g.n_left; u++) {
+      if (match_left_[u] == -1) {
+        dist_[u] = 0;
+        queue_.push_back(u);
+      } else {
+        dist_[u] = unreached;
+      }
+    }
+    int free_layer = unreached;
+    for (std::size_t i = 0; i < queue_.size(); i++) {
+      int u = queue_[i];
+      if (free_layer != unreached && dist_[u] >= free_layer) break;
+      for (int64_t e = g.start[u]; e < g.start[u + 1]; e++) {
+        int w = match_right_[g.adj[e]];
+        if (w == -1) {
+          if (free_layer == unreached) free_layer = dist_[u] + 1;
+        } else if (dist_[w] == unreached) {
+          dist_[w] = dist_[u] + 1;
+          queue_.push_back(w);
+        }
+      }
+    }
+    free_layer_ = free_layer;
+    return free_layer != unreached;
+  }
+
+  // Augmenting path from root along the layers. The stack holds the left
+  // vertices of the current path; it_[u] is the edge u is trying, so on
+  // success the path is flipped by reading the cursors, and edges already
+  // tried are skipped for the rest of the phase.
+  bool dfs(int root) {
+    const BipartiteGraph& g = *graph_;
+    stack_.clear();
+    stack_.push_back(root);
+    while (!stack_.empty()) {
+      int u = stack_.back();
+      bool pushed = false;
+      for (int64_t& e = it_[u]; e < g.start[u + 1]; e++) {
+        int w = match_right_[g.adj[e]];
+        if (w == -1) {
+          if (dist_[u] + 1 != free_layer_) continue;
+          for (int x : stack_) {
+            int v = g.adj[it_[x]++];
+            match_left_[x] = v;
+            match_right_[v] = x;
+          }
+          return true;
+        }
+        if (dist_[w] == dist_[u] + 1) {
+          stack_.push_back(w);
+          pushed = true;
+          break;
+        }
+      }
+      if (pushed) continue;
+      // Dead end: u cannot reach a free vertex in this phase
+      dist_[u] = unreached;
+      stack_.pop_back();
+      if (!stack_.empty()) it_[stack_.back()]++;
+    }
+    return false;
+  }
+
+  const BipartiteGraph* graph_ = nullptr;
+  int* match_left_ = nullptr;
+  int* match_right_ = nullptr;
+  std::vector<int> dist_;
+  std::vector<int64_t> it_;
+  std::vector<int> queue_;
+  std::vector<int> stack_;
+  int free_layer_ = unreached;
+  int phases_ = 0;
+};
+
+#endif
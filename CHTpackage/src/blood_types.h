@@ -0,0 +1,74 @@
+// Blood types of the R data.frames, for the entry points of the donation
+// matching (hopcroft_karp.cpp, hopcroft_karp_online.cpp, kidney_exchange.cpp).
+#ifndef CHT_BLOOD_TYPES_H
+#define CHT_BLOOD_TYPES_H
+
+#include <Rcpp.h>
+#include <cstddef>
+#include <cstring>
+#include <vector>
+
+// Groupe sanguin (indice dans blood_types) de chaque individu, -1 si inconnu.
+// Les CHARSXP identiques sont partagés par R, donc on compare d'abord les
+// pointeurs, et strcmp ne sert que pour les chaînes non mises en cache.
+inline std::vector<int> blood_classes(const Rcpp::IntegerVector& ids, SEXP blood_type_col,
+                                      const Rcpp::CharacterVector& blood_types) {
+  int n_types = blood_types.size();
+  int n_rows = Rf_length(blood_type_col);
+  std::vector<int> classes(ids.size(), -1);
+
+  auto find_type = [&](SEXP s) {
+    if (s == NA_STRING) return -1;
+    for (int k = 0; k < n_types; k++) {
+      if (STRING_ELT(blood_types, k) == s) return k;
+    }
+    for (int k = 0; k < n_types; k++) {
+      if (std::strcmp(CHAR(STRING_ELT(blood_types, k)), CHAR(s)) == 0) return k;
+    }
+    return -1;
+  };
+
+  if (Rf_isFactor(blood_type_col)) {
+    // Facteur : une recherche par niveau seulement
+    SEXP levels = Rf_getAttrib(blood_type_col, R_LevelsSymbol);
+    std::vector<int> level_class(Rf_length(levels));
+    for (int l = 0; l < (int)level_class.size(); l++) level_class[l] = find_type(STRING_ELT(levels, l));
+    const int* codes = INTEGER(blood_type_col);
+    for (int i = 0; i < ids.size(); i++) {
+      if (ids[i] == NA_INTEGER || ids[i] < 1 || ids[i] > n_rows) {
+        Rcpp::stop("id %d is not a row of data", ids[i]);
+      }
+      int code = codes[ids[i] - 1];
+      classes[i] = code == NA_INTEGER ? -1 : level_class[code - 1];
+    }
+  } else {
+    if (TYPEOF(blood_type_col) != STRSXP) {
+      Rcpp::stop("data$blood_type must be a character vector or a factor");
+    }
+    for (int i = 0; i < ids.size(); i++) {
+      if (ids[i] == NA_INTEGER || ids[i] < 1 || ids[i] > n_rows) {
+        Rcpp::stop("id %d is not a row of data", ids[i]);
+      }
+      classes[i] = find_type(STRING_ELT(blood_type_col, ids[i] - 1));
+    }
+  }
+  return classes;
+}
+
+// Table de compatibilité en ligne (donneur, receveur), 1 octet par paire de groupes
+inline std::vector<char> compatible_types(const Rcpp::NumericMatrix& compatibility_table,
+                                          const Rcpp::CharacterVector& blood_types) {
+  int n_types = blood_types.size();
+  if (compatibility_table.nrow() != n_types || compatibility_table.ncol() != n_types) {
+    Rcpp::stop("compatibility_table must be %d x %d to match blood_types", n_types, n_types);
+  }
+  std::vector<char> compatible((std::size_t)n_types * n_types);
+  for (int d = 0; d < n_types; d++) {
+    for (int r = 0; r < n_types; r++) {
+      compatible[(std::size_t)d * n_types + r] = compatibility_table(d, r) == 1;
+    }
+  }
+  return compatible;
+}
+
+#endif
@@ -0,0 +1,88 @@
+// Maximum bipartite matching when compatibility only depends on classes.
+//
+// With blood groups, a donor is compatible with a recipient iff the table
+// says their two types are, so the donor x recipient graph is a blow-up of
+// a K x K class graph. A maximum matching is then a maximum flow on
+//   source -> donor class (capacity: number of donors of that class)
+//   donor class -> recipient class (unbounded, if compatible)
+//   recipient class -> sink (capacity: number of recipients of that class)
+// and any split of the class flows over concrete agents is a valid
+// matching of the same size. The flow network has 2K + 2 nodes whatever
+// the number of agents, and the assignment is a counting sort: O(D + R).
+#ifndef CHT_CLASS_MATCHING_ENGINE_H
+#define CHT_CLASS_MATCHING_ENGINE_H
+
+#include <vector>
+#include "max_flow.h"
+
+// donor_class / recipient_class hold a class in 0..n_classes-1, or -1 for an
+// agent that matches nobody. compatible is n_classes x n_classes, row-major
+// (donor class, recipient class). Fills match_donor[i] with the position of
+// the recipient of donor i (or -1), match_recipient likewise, class_flow
+// with the number of pairs per (donor class, recipient class), and returns
+// the matching size.
+inline long long class_flow_matching(int n_classes, const std::vector<char>& compatible,
+                                     const std::vector<int>& donor_class,
+                                     const std::vector<int>& recipient_class,
+                                     std::vector<int>& match_donor,
+                                     std::vector<int>& match_recipient,
+                                     std::vector<long long>& class_flow) {
+  const int K = n_classes;
+  std::vector<long long> donor_count(K, 0), recipient_count(K, 0);
+  for (int c : donor_class) if (c >= 0) donor_count[c]++;
+  for (int c : recipient_class) if (c >= 0) recipient_count[c]++;
+
+  // Nodes: donor classes 0..K-1, recipient classes K..2K-1, source, sink
+  const int source = 2 * K, sink = 2 * K + 1;
+  MaxFlow network(2 * K + 2);
+  for (int c = 0; c < K; c++) {
+    if (donor_count[c] > 0) network.add_edge(source, c, donor_count[c]);
+    if (recipient_count[c] > 0) network.add_edge(K + c, sink, recipient_count[c]);
+  }
+  std::vector<int> pair_edge((std::size_t)K * K, -1);
+  for (int d = 0; d < K; d++) {
+    if (donor_count[d] == 0) continue;
+    for (int r = 0; r < K; r++) {
+      if (recipient_count[r] > 0 && compatible[(std::size_t)d * K + r]) {
+        pair_edge[(std::size_t)d * K + r] = network.add_edge(d, K + r, MaxFlow::infinite);
+      }
+    }
+  }
+  long long size = network.solve(source, sink);
+
+  class_flow.assign((std::size_t)K * K, 0);
+  for (std::size_t i = 0; i < pair_edge.size(); i++) {
+    if (pair_edge[i] != -1) class_flow[i] = network.flow(pair_edge[i]);
+  }
+
+  // Agents grouped by class (counting sort), in input order within a class
+  auto group = [K](const std::vector<int>& cls, std::vector<int>& start, std::vector<int>& order) {
+    start.assign(K + 1, 0);
+    for (int c : cls) if (c >= 0) start[c + 1]++;
+    for (int c = 0; c < K; c++) start[c + 1] += start[c];
+    order.resize(start[K]);
+    std::vector<int> fill(start.begin(), start.end() - 1);
+    for (int i = 0; i < (int)cls.size(); i++) if (cls[i] >= 0) order[fill[cls[i]]++] = i;
+  };
+  std::vector<int> donor_start, donor_order, recipient_start, recipient_order;
+  group(donor_class, donor_start, donor_order);
+  group(recipient_class, recipient_start, recipient_order);
+
+  match_donor.assign(donor_class.size(), -1);
+  match_recipient.assign(recipient_class.size(), -1);
+  std::vector<int> donor_next(donor_start.begin(), donor_start.end() - 1);
+  std::vector<int> recipient_next(recipient_start.begin(), recipient_start.end() - 1);
+  for (int d = 0; d < K; d++) {
+    for (int r = 0; r < K; r++) {
+      for (long long f = class_flow[(std::size_t)d * K + r]; f > 0; f--) {
+        int i = donor_order[donor_next[d]++];
+        int j = recipient_order[recipient_next[r]++];
+        match_donor[i] = j;
+        match_recipient[j] = i;
+      }
+    }
+  }
+  return size;
+}
+
+#endif
@@ -0,0 +1,84 @@
+// Integer core of the classic Gale-Shapley algorithm.
+//
+// This header has no R dependency: the Rcpp entry points intern the names
+// once and hand dense ids to the solver, so the proposal loop only touches
+// contiguous int arrays.
+#ifndef CHT_GALE_SHAPLEY_ENGINE_H
+#define CHT_GALE_SHAPLEY_ENGINE_H
+
+#include <cstddef>
+#include <vector>
+#include "solver_stats.h"
+
+// Men are numbered 0..n_men-1 and women 0..n_women-1.
+struct GSInstance {
+  int n_men = 0;
+  int n_women = 0;
+  std::vector<int> pref_start;  // n_men + 1 offsets into pref_list
+  std::vector<int> pref_list;   // men's preference lists, concatenated
+  std::vector<int> rank;        // n_women x n_men, row-major, lower = better
+};
+
+// Scratch arrays of gale_shapley_solve(), reusable between solves.
+struct GSScratch {
+  std::vector<int> next;
+  std::vector<int> free_men;
+};
+
+// Runs the men-proposing algorithm and fills engaged[w] with the man held by
+// woman w, or -1 if she received no proposal. Free men are kept on a stack;
+// a man who runs out of women leaves the market unmatched. stats receives
+// every proposal and rejection (see solver_stats.h).
+template <typename Stats>
+void gale_shapley_solve(const GSInstance& inst, std::vector<int>& engaged, GSScratch& scratch,
+                        Stats& stats) {
+  const int n_men = inst.n_men;
+  const int* pref_list = inst.pref_list.data();
+  const int* pref_start = inst.pref_start.data();
+
+  engaged.assign(inst.n_women, -1);
+  std::vector<int>& next = scratch.next;
+  next.assign(inst.pref_start.begin(), inst.pref_start.end() - 1);
+
+  // Man 0 ends up on top, so men propose in input order
+  std::vector<int>& free_men = scratch.free_men;
+  free_men.resize(n_men);
+  for (int i = 0; i < n_men; i++) free_men[i] = n_men - 1 - i;
+
+  while (!free_men.empty()) {
+    int man = free_men.back();
+    if (next[man] == pref_start[man + 1]) {
+      free_men.pop_back();
+      continue;
+    }
+
+    int woman = pref_list[next[man]++];
+    stats.proposal();
+    const int* rank = inst.rank.data() + (std::size_t)woman * n_men;
+    int current = engaged[woman];
+
+    if (current == -1) {
+      engaged[woman] = man;
+      free_men.pop_back();
+    } else if (rank[man] < rank[current]) {
+      engaged[woman] = man;
+      free_men.back() = current;
+      stats.rejection();
+    } else {
+      stats.rejection();
+    }
+  }
+}
+
+inline void gale_shapley_solve(const GSInstance& inst, std::vector<int>& engaged,
+                               GSScratch& scratch) {
+  NullStats stats;
+  gale_shapley_solve(inst, engaged, scratch, stats);
+}
+
+inline void gale_shapley_solve(const GSInstance& inst, std::vector<int>& engaged) {
+  GSScratch scratch;
+  gale_shapley_solve(inst, engaged, scratch);
+}
+
+#endif
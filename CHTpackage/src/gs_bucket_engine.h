@@ -0,0 +1,292 @@
+// Integer core of the bucket (best-first) Gale-Shapley algorithm.
+//
+// Bucket k holds the men whose next proposal is to the k-th woman of their
+// list. Proposals are always taken from the lowest non-empty bucket. The
+// engine keeps two structures so that no step scans n entries:
+//  - fiance[f], the inverse of the matching, answers "who holds f" in O(1);
+//  - a hierarchical bitmap of non-empty buckets plus a cursor on the lowest
+//    one. A displaced man can fall back into a lower bucket, so the cursor is
+//    not monotone; when its bucket runs dry the next one is found with a few
+//    64-bit word scans (one per level, 3 levels up to n = 262144).
+// Each proposal is therefore O(1) and a full run is O(n^2).
+#ifndef CHT_GS_BUCKET_ENGINE_H
+#define CHT_GS_BUCKET_ENGINE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+#include "solver_stats.h"
+
+// Set of integers in [0, n) with find-next-set in O(log64 n).
+class BucketBitmap {
+public:
+  // Reuses the storage of earlier resets.
+  void reset(int n) {
+    std::size_t words = ((std::size_t)n + 63) / 64;
+    std::size_t depth = 0;
+    do {
+      if (depth == levels_.size()) levels_.emplace_back();
+      levels_[depth++].assign(words == 0 ? 1 : words, 0);
+      words = (words + 63) / 64;
+    } while (levels_[depth - 1].size() > 1);
+    levels_.resize(depth);
+  }
+
+  void set(int i) {
+    std::size_t pos = i;
+    for (auto& level : levels_) {
+      uint64_t& word = level[pos >> 6];
+      bool was_empty = word == 0;
+      word |= uint64_t(1) << (pos & 63);
+      if (!was_empty) return;
+      pos >>= 6;
+    }
+  }
+
+  void clear(int i) {
+    std::size_t pos = i;
+    for (auto& level : levels_) {
+      uint64_t& word = level[pos >> 6];
+      word &= ~(uint64_t(1) << (pos & 63));
+      if (word != 0) return;
+      pos >>= 6;
+    }
+  }
+
+  // Smallest element >= from, or -1.
+  int find_next(int from) const {
+    std::size_t pos = from;
+    std::size_t level = 0;
+    for (; level < levels_.size(); level++) {
+      const auto& words = levels_[level];
+      std::size_t w = pos >> 6;
+      if (w >= words.size()) return -1;
+      uint64_t word = words[w] & (~uint64_t(0) << (pos & 63));
+      if (word) {
+        pos = (w << 6) | __builtin_ctzll(word);
+        break;
+      }
+      pos = w + 1;
+    }
+    if (level == levels_.size()) return -1;
+    while (level > 0) {
+      level--;
+      pos = (pos << 6) | __builtin_ctzll(levels_[level][pos]);
+    }
+    return (int)pos;
+  }
+
+private:
+  std::vector<std::vector<uint64_t>> levels_;
+};
+
+// Preference lists of the men and rank tables of the women of an n x n
+// instance, in one contiguous allocation of 2 n^2 entries:
+//   [0, n^2)     men_pref(h)[k]   = k-th woman of man h
+//   [n^2, 2n^2)  women_rank(f)[h] = position of man h in f's list
+// Index is uint16_t for n <= 65535 and uint32_t above (see
+// dispatch_index_width), which halves the footprint of the common case
+// compared to int. The largest value of Index is kept as a "none" sentinel.
+template <typename Index>
+class PreferenceStore {
+public:
+  typedef Index index_type;
+  static constexpr Index none = std::numeric_limits<Index>::max();
+
+  // Entries are left uninitialised for the caller to overwrite; the buffer
+  // only reallocates when n grows past every earlier size.
+  void reset(int n) {
+    n_ = n;
+    buffer_.resize(2 * (std::size_t)n * n);
+  }
+
+  int size() const { return n_; }
+
+  Index* men_pref(int h) { return buffer_.data() + (std::size_t)h * n_; }
+  const Index* men_pref(int h) const { return buffer_.data() + (std::size_t)h * n_; }
+
+  Index* women_rank(int f) { return buffer_.data() + ((std::size_t)n_ + f) * n_; }
+  const Index* women_rank(int f) const { return buffer_.data() + ((std::size_t)n_ + f) * n_; }
+
+  // Accessors shared with MatrixPreferences, used by gs_bucket_solve()
+  int list_length(int) const { return n_; }
+  int man_choice(int h, int k) const { return men_pref(h)[k]; }
+  int woman_rank(int f, int h) const { return women_rank(f)[h]; }
+
+private:
+  int n_ = 0;
+  std::vector<Index> buffer_;
+};
+
+// Read-only view of an n x n instance stored in caller-owned int arrays,
+// such as R integer matrices, without copying them. Entry (agent, k) sits
+// at data[agent * agent_stride + k * pos_stride], so the same view reads
+// one agent per column or one agent per row. Values are 1-based:
+//   men      k-th woman of man h
+//   ranks    position of man h in f's list
+// Entries are trusted; callers validate them once beforehand.
+class MatrixPreferences {
+public:
+  typedef uint32_t index_type;
+
+  MatrixPreferences(int n, const int* men, const int* ranks,
+                    std::ptrdiff_t agent_stride, std::ptrdiff_t pos_stride)
+      : n_(n), men_(men), ranks_(ranks), agent_stride_(agent_stride), pos_stride_(pos_stride) {}
+
+  int size() const { return n_; }
+  int list_length(int) const { return n_; }
+  int man_choice(int h, int k) const { return men_[h * agent_stride_ + k * pos_stride_] - 1; }
+  int woman_rank(int f, int h) const { return ranks_[f * agent_stride_ + h * pos_stride_] - 1; }
+
+private:
+  int n_;
+  const int* men_;
+  const int* ranks_;
+  std::ptrdiff_t agent_stride_, pos_stride_;
+};
+
+// First agent of a matrix laid out as in MatrixPreferences that does not
+// list 1..n exactly once, or -1. seen is scratch space.
+inline int first_invalid_agent(const int* data, int n, std::ptrdiff_t agent_stride,
+                               std::ptrdiff_t pos_stride, std::vector<int>& seen) {
+  seen.assign(n, -1);
+  for (int a = 0; a < n; a++) {
+    for (int k = 0; k < n; k++) {
+      int v = data[a * agent_stride + k * pos_stride];
+      if (v < 1 || v > n || seen[v - 1] == a) return a;
+      seen[v - 1] = a;
+    }
+  }
+  return -1;
+}
+
+// Turns 1-based preference lists into 1-based ranks with the same layout.
+inline void invert_matrix_lists(const int* lists, int n, std::ptrdiff_t agent_stride,
+                                std::ptrdiff_t pos_stride, std::vector<int>& ranks) {
+  ranks.resize((std::size_t)n * n);
+  for (int f = 0; f < n; f++) {
+    for (int k = 0; k < n; k++) {
+      int h = lists[f * agent_stride + k * pos_stride] - 1;
+      ranks[f * agent_stride + h * pos_stride] = k + 1;
+    }
+  }
+}
+
+// Calls fn(Index()) with the narrowest index type that can number n agents
+// and still keep one value free for the sentinel.
+template <typename Fn>
+inline void dispatch_index_width(int n, Fn&& fn) {
+  if (n <= 65535) {
+    fn(uint16_t());
+  } else {
+    fn(uint32_t());
+  }
+}
+
+// Scratch arrays of gs_bucket_solve(). Keeping one alive between solves of
+// same-sized instances removes every allocation from the solver.
+template <typename Index>
+struct BucketWorkspace {
+  std::vector<Index> next_choice, fiance, head, link;
+  BucketBitmap non_empty;
+};
+
+// Solves the instance held in prefs (a PreferenceStore, a MatrixPreferences
+// or a MappedPreferences). Fills matching[h] with the woman of man h and
+// returns the number of proposals made. Man h proposes to the first
+// prefs.list_length(h) women of his list; if they all reject him he stays
+// unmatched (matching[h] = -1). Buckets are intrusive stacks threaded
+// through one link array, so the engine state is O(n). stats receives
+// proposals, rejections and bucket moves (see solver_stats.h).
+template <typename Prefs, typename Stats>
+long long gs_bucket_solve(const Prefs& prefs, std::vector<int>& matching,
+                          BucketWorkspace<typename Prefs::index_type>& ws, Stats& stats) {
+  typedef typename Prefs::index_type Index;
+  const int n = prefs.size();
+  const Index none = std::numeric_limits<Index>::max();
+  matching.assign(n, -1);
+  if (n == 0) return 0;
+
+  std::vector<Index>& next_choice = ws.next_choice;
+  std::vector<Index>& fiance = ws.fiance;
+  std::vector<Index>& head = ws.head;
+  std::vector<Index>& link = ws.link;
+  BucketBitmap& non_empty = ws.non_empty;
+  next_choice.assign(n, 0);
+  fiance.assign(n, none);
+  head.assign(n, none);
+  link.assign(n, none);
+  non_empty.reset(n);
+
+  for (int h = n - 1; h >= 0; h--) {
+    if (prefs.list_length(h) == 0) continue;
+    link[h] = head[0];
+    head[0] = (Index)h;
+    stats.bucket_push(0);
+  }
+  if (head[0] == none) return 0;
+  non_empty.set(0);
+
+  long long proposals = 0;
+  int p = 0;
+  while (p != -1) {
+    // Pop proposal
+    int h = head[p];
+    head[p] = link[h];
+    if (head[p] == none) non_empty.clear(p);
+    stats.bucket_pop(p);
+    int f = prefs.man_choice(h, next_choice[h]);
+    proposals++;
+    stats.proposal();
+
+    int current = fiance[f] == none ? -1 : (int)fiance[f];
+    int rejected = h;
+    if (current == -1) {
+      // free woman -> accept
+      fiance[f] = (Index)h;
+      matching[h] = f;
+      rejected = -1;
+    } else {
+      if (prefs.woman_rank(f, h) < prefs.woman_rank(f, current)) {
+        // replace fiancé
+        fiance[f] = (Index)h;
+        matching[h] = f;
+        matching[current] = -1;
+        rejected = current;
+      }
+    }
+
+    if (rejected != -1) {
+      stats.rejection();
+      int nc = ++next_choice[rejected];
+      if (nc < prefs.list_length(rejected)) {
+        if (head[nc] == none) non_empty.set(nc);
+        link[rejected] = head[nc];
+        head[nc] = (Index)rejected;
+        stats.bucket_push(nc);
+        if (nc < p) p = nc;
+      }
+    }
+
+    if (head[p] == none) p = non_empty.find_next(p);
+  }
+
+  return proposals;
+}
+
+template <typename Prefs>
+long long gs_bucket_solve(const Prefs& prefs, std::vector<int>& matching,
+                          BucketWorkspace<typename Prefs::index_type>& ws) {
+  NullStats stats;
+  return gs_bucket_solve(prefs, matching, ws, stats);
+}
+
+// Same, with a workspace used for this solve only.
+template <typename Prefs>
+long long gs_bucket_solve(const Prefs& prefs, std::vector<int>& matching) {
+  BucketWorkspace<typename Prefs::index_type> ws;
+  return gs_bucket_solve(prefs, matching, ws);
+}
+
+#endif
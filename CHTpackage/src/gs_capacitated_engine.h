@@ -0,0 +1,171 @@
+// Many-to-one (hospitals/residents) variant of the bucket Gale-Shapley
+// engine: applicants propose to sites with capacities.
+//
+// Applicants have truncated lists and sites only rank the applicants they
+// accept, so nothing here is n x n:
+//  - lists are concatenated (CSR), and the rank a site gives an applicant is
+//    stored next to the applicant's list entry, so a proposal reads it in
+//    O(1) without any per-site table;
+//  - applicants wait in buckets by list position, and proposals are taken
+//    from the lowest non-empty bucket, as in gs_bucket_solve();
+//  - each site keeps its held applicants in a max-heap keyed by rank, so
+//    the worst one is at the top and an eviction is O(log c). All heaps
+//    share one slab of sum(capacity) entries; a site only ever holds
+//    applicants it ranks, so its capacity is first capped at the length of
+//    its list.
+// Memory is O(total list length + number of applicants).
+#ifndef CHT_GS_CAPACITATED_ENGINE_H
+#define CHT_GS_CAPACITATED_ENGINE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "gs_bucket_engine.h"
+
+// Applicants are numbered 0..n_applicants-1 and sites 0..n_sites-1.
+struct HRInstance {
+  int n_applicants = 0;
+  int n_sites = 0;
+  std::vector<int> pref_start;  // n_applicants + 1 offsets into pref_list
+  std::vector<int> pref_list;   // applicants' lists of sites, concatenated
+  std::vector<int> pair_rank;   // rank of the applicant in the site's list, -1 if unranked
+  std::vector<int> capacity;    // per site
+};
+
+// Fills pair_rank from the sites' lists (CSR over sites, applicants in
+// order of preference) and caps each capacity at the length of the site's
+// list. Linear in the total length of all lists.
+inline void hr_build_ranks(HRInstance& inst, const std::vector<int>& site_start,
+                           const std::vector<int>& site_list) {
+  const int n_sites = inst.n_sites;
+  const std::size_t n_entries = inst.pref_list.size();
+  for (int s = 0; s < n_sites; s++) {
+    inst.capacity[s] = std::min(inst.capacity[s], site_start[s + 1] - site_start[s]);
+  }
+
+  // Reverse index: list entries grouped by site
+  std::vector<int> by_site_start(n_sites + 1, 0);
+  for (int s : inst.pref_list) by_site_start[s + 1]++;
+  for (int s = 0; s < n_sites; s++) by_site_start[s + 1] += by_site_start[s];
+  std::vector<int> by_site(n_entries);
+  std::vector<int> entry_owner(n_entries);
+  {
+    std::vector<int> fill(by_site_start.begin(), by_site_start.end() - 1);
+    for (int a = 0; a < inst.n_applicants; a++) {
+      for (int e = inst.pref_start[a]; e < inst.pref_start[a + 1]; e++) {
+        by_site[fill[inst.pref_list[e]]++] = e;
+        entry_owner[e] = a;
+      }
+    }
+  }
+
+  inst.pair_rank.assign(n_entries, -1);
+  std::vector<int> rank_of(inst.n_applicants, -1);
+  for (int s = 0; s < n_sites; s++) {
+    for (int k = site_start[s]; k < site_start[s + 1]; k++) rank_of[site_list[k]] = k - site_start[s];
+    for (int i = by_site_start[s]; i < by_site_start[s + 1]; i++) {
+      int e = by_site[i];
+      inst.pair_rank[e] = rank_of[entry_owner[e]];
+    }
+    for (int k = site_start[s]; k < site_start[s + 1]; k++) rank_of[site_list[k]] = -1;
+  }
+}
+
+// Solves the instance; fills assigned[a] with the site of applicant a (or
+// -1) and returns the number of proposals. The result is the
+// applicant-optimal stable assignment.
+inline long long hr_bucket_solve(const HRInstance& inst, std::vector<int>& assigned) {
+  const int n_applicants = inst.n_applicants;
+  const int n_sites = inst.n_sites;
+  const int* pref_start = inst.pref_start.data();
+  const int* pref_list = inst.pref_list.data();
+  const int* pair_rank = inst.pair_rank.data();
+  assigned.assign(n_applicants, -1);
+
+  // Heap slab: site s owns [heap_start[s], heap_start[s] + capacity[s])
+  std::vector<std::size_t> heap_start(n_sites + 1, 0);
+  for (int s = 0; s < n_sites; s++) heap_start[s + 1] = heap_start[s] + inst.capacity[s];
+  std::vector<uint64_t> heap(heap_start[n_sites]);  // (rank << 32) | applicant
+  std::vector<int> held(n_sites, 0);
+
+  // Buckets by list position
+  int max_len = 0;
+  for (int a = 0; a < n_applicants; a++) {
+    max_len = std::max(max_len, pref_start[a + 1] - pref_start[a]);
+  }
+  if (max_len == 0) return 0;
+  std::vector<int> next(n_applicants, 0);
+  std::vector<int> head(max_len, -1);
+  std::vector<int> link(n_applicants, -1);
+  BucketBitmap non_empty;
+  non_empty.reset(max_len);
+  for (int a = n_applicants - 1; a >= 0; a--) {
+    if (pref_start[a + 1] == pref_start[a]) continue;
+    link[a] = head[0];
+    head[0] = a;
+  }
+  if (head[0] != -1) non_empty.set(0);
+
+  long long proposals = 0;
+  int p = non_empty.find_next(0);
+  while (p != -1) {
+    int a = head[p];
+    head[p] = link[a];
+    if (head[p] == -1) non_empty.clear(p);
+    int e = pref_start[a] + next[a];
+    int s = pref_list[e];
+    int rank = pair_rank[e];
+    proposals++;
+
+    int rejected = a;
+    if (rank != -1 && inst.capacity[s] > 0) {
+      uint64_t key = ((uint64_t)rank << 32) | (uint32_t)a;
+      uint64_t* h = heap.data() + heap_start[s];
+      int size = held[s];
+      if (size < inst.capacity[s]) {
+        // Sift up
+        int i = size;
+        while (i > 0 && h[(i - 1) / 2] < key) {
+          h[i] = h[(i - 1) / 2];
+          i = (i - 1) / 2;
+        }
+        h[i] = key;
+        held[s] = size + 1;
+        assigned[a] = s;
+        rejected = -1;
+      } else if (key < h[0]) {
+        // Evict the worst held applicant and sift the newcomer down
+        rejected = (int)(h[0] & 0xffffffffu);
+        assigned[rejected] = -1;
+        int i = 0;
+        while (true) {
+          int child = 2 * i + 1;
+          if (child >= size) break;
+          if (child + 1 < size && h[child + 1] > h[child]) child++;
+          if (h[child] <= key) break;
+          h[i] = h[child];
+          i = child;
+        }
+        h[i] = key;
+        assigned[a] = s;
+      }
+    }
+
+    if (rejected != -1) {
+      int nc = ++next[rejected];
+      if (nc < pref_start[rejected + 1] - pref_start[rejected]) {
+        if (head[nc] == -1) non_empty.set(nc);
+        link[rejected] = head[nc];
+        head[nc] = rejected;
+        if (nc < p) p = nc;
+      }
+    }
+
+    if (head[p] == -1) p = non_empty.find_next(p);
+  }
+
+  return proposals;
+}
+
+#endif
@@ -0,0 +1,350 @@
+// Men-proposing Gale-Shapley that keeps its state between market changes.
+//
+// The engine stores a time-stamped proposal history. next[m] is the next
+// position m will propose to (his partner, if any, sits at next[m] - 1).
+// Each woman logs the proposals she received and the men she accepted, and
+// each man logs where he was accepted. Continuing the proposals from a
+// state produced by a genuine proposal history ends in the man-optimal
+// stable matching, so a change only has to cut the history back to a
+// prefix that is still genuine for the new market:
+//  - truncating woman w at time t drops every proposal she received from t
+//    on. Those men are rolled back to just before w, and the man she held
+//    at t (if any) takes her back;
+//  - rolling a man back drops his later proposals. A woman who had
+//    accepted one of them is truncated at that acceptance, because her
+//    later decisions were made against him. Women who only rejected him
+//    keep their history.
+// Only the cut proposal chains are replayed, so a delta touching a few
+// agents costs far less than a full O(n^2) solve.
+//
+// Agents are never renumbered: a removed agent keeps its slot, marked
+// inactive. New agents go to the bottom of every existing list; callers
+// place them with update_*_prefs().
+#ifndef CHT_GS_INCREMENTAL_ENGINE_H
+#define CHT_GS_INCREMENTAL_ENGINE_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+class IncrementalGS {
+public:
+  int n_men() const { return (int)man_list_.size(); }
+  int n_women() const { return (int)woman_list_.size(); }
+  bool man_active(int m) const { return man_active_[m]; }
+  bool woman_active(int w) const { return woman_active_[w]; }
+  int partner_of_man(int m) const { return man_partner_[m]; }
+  int partner_of_woman(int w) const { return woman_partner_[w]; }
+
+  // Proposals and rollbacks performed since the counter was last read.
+  long long take_work() {
+    long long work = work_;
+    work_ = 0;
+    return work;
+  }
+
+  // Starts a new market from complete or partial lists and solves it.
+  void reset(const std::vector<std::vector<int>>& men_prefs,
+             const std::vector<std::vector<int>>& women_prefs) {
+    int n_men = (int)men_prefs.size();
+    int n_women = (int)women_prefs.size();
+    man_active_.assign(n_men, true);
+    woman_active_.assign(n_women, true);
+    man_partner_.assign(n_men, -1);
+    woman_partner_.assign(n_women, -1);
+    next_.assign(n_men, 0);
+    man_list_.assign(n_men, std::vector<int>());
+    man_pos_.assign(n_men, std::vector<int>());
+    proposal_time_.assign(n_men, std::vector<long long>());
+    accepted_at_.assign(n_men, std::vector<Event>());
+    woman_list_.assign(n_women, std::vector<int>());
+    woman_rank_.assign(n_women, std::vector<int>());
+    received_.assign(n_women, std::vector<Event>());
+    held_.assign(n_women, std::vector<Event>());
+    for (int m = 0; m < n_men; m++) set_list(man_list_[m], man_pos_[m], men_prefs[m], n_women);
+    for (int w = 0; w < n_women; w++) set_list(woman_list_[w], woman_rank_[w], women_prefs[w], n_men);
+
+    free_men_.clear();
+    for (int m = n_men - 1; m >= 0; m--) free_men_.push_back(m);
+    run();
+  }
+
+  // Adds a man with the given ordered list of women (other women follow in
+  // id order) and returns his id.
+  int add_man(const std::vector<int>& prefs) {
+    int m = n_men();
+    man_active_.push_back(true);
+    man_partner_.push_back(-1);
+    next_.push_back(0);
+    man_list_.emplace_back();
+    man_pos_.emplace_back();
+    proposal_time_.emplace_back();
+    accepted_at_.emplace_back();
+    set_list(man_list_[m], man_pos_[m], prefs, n_women());
+
+    for (int w = 0; w < n_women(); w++) {
+      woman_rank_[w].push_back((int)woman_list_[w].size());
+      woman_list_[w].push_back(m);
+    }
+
+    free_men_.push_back(m);
+    run();
+    return m;
+  }
+
+  // Adds a woman with the given ordered list of men (other men follow in id
+  // order) and returns her id. Men who had exhausted their lists may now
+  // propose to her.
+  int add_woman(const std::vector<int>& prefs) {
+    int w = n_women();
+    woman_active_.push_back(true);
+    woman_partner_.push_back(-1);
+    woman_list_.emplace_back();
+    woman_rank_.emplace_back();
+    received_.emplace_back();
+    held_.emplace_back();
+    set_list(woman_list_[w], woman_rank_[w], prefs, n_men());
+
+    for (int m = 0; m < n_men(); m++) {
+      bool exhausted = next_[m] == (int)man_list_[m].size();
+      man_pos_[m].push_back((int)man_list_[m].size());
+      man_list_[m].push_back(w);
+      if (exhausted && man_active_[m] && man_partner_[m] == -1) free_men_.push_back(m);
+    }
+
+    run();
+    return w;
+  }
+
+  // The man's proposals leave the history; women who accepted him are cut
+  // back to before him.
+  void remove_man(int m) {
+    if (!man_active_[m]) return;
+    man_active_[m] = false;
+    rollback(m, 0);
+    process_truncations();
+    run();
+  }
+
+  // Proposals to a removed woman simply become skips, so nobody else's
+  // history changes: only her partner goes back to proposing.
+  void remove_woman(int w) {
+    if (!woman_active_[w]) return;
+    woman_active_[w] = false;
+    int m = woman_partner_[w];
+    if (m != -1) {
+      woman_partner_[w] = -1;
+      man_partner_[m] = -1;
+      free_men_.push_back(m);
+    }
+    run();
+  }
+
+  // Replaces the list of man m; women left out keep their previous order
+  // after the listed ones. His history survives up to the first position
+  // where the old and new lists differ.
+  void update_man_prefs(int m, const std::vector<int>& prefs) {
+    std::vector<int> order = merge_order(prefs, man_list_[m]);
+    int keep = 0;
+    while (keep < next_[m] && order[keep] == man_list_[m][keep]) keep++;
+    rollback(m, keep);
+    set_list(man_list_[m], man_pos_[m], order, n_women());
+    process_truncations();
+    run();
+  }
+
+  // Replaces the list of woman w; men left out keep their previous order
+  // after the listed ones. Her history is cut at the first proposal she
+  // would now answer differently.
+  void update_woman_prefs(int w, const std::vector<int>& prefs) {
+    std::vector<int> order = merge_order(prefs, woman_list_[w]);
+    set_list(woman_list_[w], woman_rank_[w], order, n_men());
+    long long first_change = first_changed_decision(w);
+    if (first_change != -1) truncations_.push_back(Event(w, first_change));
+    process_truncations();
+    run();
+  }
+
+private:
+  typedef std::pair<int, long long> Event;  // (agent or position, time)
+
+  // list = prefs followed by the ids in [0, n) that prefs does not contain;
+  // pos[x] = position of x in list.
+  static void set_list(std::vector<int>& list, std::vector<int>& pos,
+                       const std::vector<int>& prefs, int n) {
+    pos.assign(n, -1);
+    list.clear();
+    list.reserve(n);
+    for (int x : prefs) {
+      if (pos[x] != -1) continue;
+      pos[x] = (int)list.size();
+      list.push_back(x);
+    }
+    for (int x = 0; x < n; x++) {
+      if (pos[x] != -1) continue;
+      pos[x] = (int)list.size();
+      list.push_back(x);
+    }
+  }
+
+  // prefs followed by the rest of old_list in its current order.
+  static std::vector<int> merge_order(const std::vector<int>& prefs,
+                                      const std::vector<int>& old_list) {
+    std::vector<char> listed(old_list.size(), 0);
+    std::vector<int> order;
+    order.reserve(old_list.size());
+    for (int x : prefs) {
+      if (listed[x]) continue;
+      listed[x] = 1;
+      order.push_back(x);
+    }
+    for (int x : old_list) {
+      if (!listed[x]) order.push_back(x);
+    }
+    return order;
+  }
+
+  // The proposal of m to w at time t is still part of the history.
+  bool in_history(int m, int w, long long t) const {
+    int pos = man_pos_[m][w];
+    return pos < next_[m] && proposal_time_[m][pos] == t;
+  }
+
+  // Replays the proposals in the history of w against her current ranks
+  // and returns the time of the first one whose answer changes, or -1.
+  long long first_changed_decision(int w) const {
+    const std::vector<Event>& held = held_[w];
+    std::size_t next_held = 0;
+    int current = -1;
+    for (const Event& event : received_[w]) {
+      int m = event.first;
+      long long time = event.second;
+      while (next_held < held.size() && held[next_held].second < time) next_held++;
+      bool was_accepted = next_held < held.size() && held[next_held].second == time;
+      if (!in_history(m, w, time)) continue;
+      bool accepted = current == -1 || woman_rank_[w][m] < woman_rank_[w][current];
+      if (accepted != was_accepted) return time;
+      if (accepted) current = m;
+    }
+    return -1;
+  }
+
+  // Drops the proposals of m from position p on and queues a truncation of
+  // every woman who accepted one of them.
+  void rollback(int m, int p) {
+    if (p >= next_[m]) return;
+    work_++;
+    std::vector<Event>& accepted = accepted_at_[m];
+    while (!accepted.empty() && accepted.back().first >= p) {
+      truncations_.push_back(Event(man_list_[m][accepted.back().first], accepted.back().second));
+      accepted.pop_back();
+    }
+    int w = man_partner_[m];
+    if (w != -1) {
+      woman_partner_[w] = -1;
+      man_partner_[m] = -1;
+    }
+    next_[m] = p;
+    proposal_time_[m].resize(p);
+    if (man_active_[m]) free_men_.push_back(m);
+  }
+
+  // Cuts the history of woman w from time t on: she goes back to the man z
+  // she held just before t. Women only trade up, so a later proposal she
+  // rejected from a man she ranks below z is still genuine and stays; the
+  // other suitors from t on are rolled back. Proposals to a removed woman
+  // are skips and never need repairing.
+  void truncate(int w, long long t) {
+    if (!woman_active_[w]) return;
+    std::vector<Event>& held = held_[w];
+    std::size_t held_cut = held.size();
+    while (held_cut > 0 && held[held_cut - 1].second >= t) held_cut--;
+    int z = held_cut == 0 ? -1 : held[held_cut - 1].first;
+    if (z != -1 && !in_history(z, w, held[held_cut - 1].second)) z = -1;
+
+    std::vector<Event>& received = received_[w];
+    std::size_t cut = received.size();
+    while (cut > 0 && received[cut - 1].second >= t) cut--;
+    std::size_t kept = cut;
+    std::size_t next_held = held_cut;
+    for (std::size_t i = cut; i < received.size(); i++) {
+      int m = received[i].first;
+      long long time = received[i].second;
+      while (next_held < held.size() && held[next_held].second < time) next_held++;
+      bool was_accepted = next_held < held.size() && held[next_held].second == time;
+      if (!in_history(m, w, time)) continue;
+      if (!was_accepted && z != -1 && woman_rank_[w][m] > woman_rank_[w][z]) {
+        received[kept++] = received[i];
+      } else {
+        rollback(m, man_pos_[m][w]);
+      }
+    }
+    received.resize(kept);
+    held.resize(held_cut);
+
+    if (woman_partner_[w] == z) return;
+    if (woman_partner_[w] != -1) man_partner_[woman_partner_[w]] = -1;
+    woman_partner_[w] = -1;
+    if (z != -1) {
+      rollback(z, man_pos_[z][w] + 1);
+      woman_partner_[w] = z;
+      man_partner_[z] = w;
+    }
+  }
+
+  void process_truncations() {
+    while (!truncations_.empty()) {
+      Event event = truncations_.back();
+      truncations_.pop_back();
+      truncate(event.first, event.second);
+    }
+  }
+
+  // Plain proposals from the free men until the state is stable again.
+  void run() {
+    while (!free_men_.empty()) {
+      int m = free_men_.back();
+      if (!man_active_[m] || man_partner_[m] != -1 ||
+          next_[m] == (int)man_list_[m].size()) {
+        free_men_.pop_back();
+        continue;
+      }
+
+      int pos = next_[m]++;
+      int w = man_list_[m][pos];
+      long long time = ++clock_;
+      proposal_time_[m].push_back(time);
+      if (!woman_active_[w]) continue;
+      work_++;
+      received_[w].push_back(Event(m, time));
+
+      int current = woman_partner_[w];
+      if (current == -1 || woman_rank_[w][m] < woman_rank_[w][current]) {
+        woman_partner_[w] = m;
+        man_partner_[m] = w;
+        held_[w].push_back(Event(m, time));
+        accepted_at_[m].push_back(Event(pos, time));
+        free_men_.pop_back();
+        if (current != -1) {
+          man_partner_[current] = -1;
+          free_men_.push_back(current);
+        }
+      }
+    }
+  }
+
+  std::vector<char> man_active_, woman_active_;
+  std::vector<int> man_partner_, woman_partner_;
+  std::vector<int> next_;
+  std::vector<std::vector<int>> man_list_, man_pos_;     // list and position of each woman
+  std::vector<std::vector<long long>> proposal_time_;    // time of each proposal in the history
+  std::vector<std::vector<Event>> accepted_at_;          // (position, time) of each acceptance
+  std::vector<std::vector<int>> woman_list_, woman_rank_;
+  std::vector<std::vector<Event>> received_, held_;      // (man, time), in time order
+  std::vector<int> free_men_;
+  std::vector<Event> truncations_;
+  long long clock_ = 0;
+  long long work_ = 0;
+};
+
+#endif
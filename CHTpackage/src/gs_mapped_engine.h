@@ -0,0 +1,459 @@
+// Binary preference files, solved through a memory mapping.
+//
+// A complete profile at n = 30000 is 1.8e9 entries per side, too much for
+// R lists or even an in-memory matrix. Instances are written once to a
+// binary file and the bucket engine reads the men's lists straight from
+// the mapped pages, so only the pages it touches are loaded and the kernel
+// can drop them again under memory pressure.
+//
+// Layout (native byte order, checked through byte_order):
+//   PrefFileHeader, 64 bytes
+//   men side at men_offset, women side at women_offset, each one either
+//     complete   n x n ids, agent after agent
+//     truncated  uint64 start[n + 1], then start[n] ids: agent a lists
+//                ids start[a] .. start[a + 1] - 1 (flag pref_file_truncated)
+// Ids are 0-based and index_bytes wide: 2 for n <= 65535, 4 above, as in
+// dispatch_index_width(). Both sides start on 8-byte boundaries.
+//
+// The women's side holds lists, not ranks. The solver turns it into the
+// rank table in a single sequential pass, validating it on the way; the
+// table can itself live in a mapped scratch file when it does not fit in
+// memory. A woman ranks the men missing from her list after all the others,
+// as in gale_shapley_solve(); a man only proposes to the women on his list.
+// The men's side is never read as a whole: ids are range-checked as the
+// solver reads them, and a man listing a woman twice is harmless (his
+// second proposal to her is rejected).
+#ifndef CHT_GS_MAPPED_ENGINE_H
+#define CHT_GS_MAPPED_ENGINE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "gs_bucket_engine.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+static const char pref_file_magic[8] = {'C', 'H', 'T', 'P', 'R', 'E', 'F', '\0'};
+static const uint32_t pref_file_version = 1;
+static const uint32_t pref_file_byte_order = 0x01020304;
+static const uint32_t pref_file_truncated = 1;
+
+struct PrefFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t n;
+  uint32_t index_bytes;
+  uint32_t flags;
+  uint64_t men_offset;
+  uint64_t women_offset;
+  uint64_t file_size;
+  uint64_t reserved;
+};
+static_assert(sizeof(PrefFileHeader) == 64, "PrefFileHeader must be 64 bytes");
+
+// Read-only or read-write mapping of a whole file, or anonymous memory.
+class MappedFile {
+public:
+  MappedFile() = default;
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+  ~MappedFile() { close(); }
+
+  void open_read(const std::string& path) {
+    close();
+#ifdef _WIN32
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) fail("cannot open", path);
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size)) fail("cannot read the size of", path);
+    size_ = (std::size_t)size.QuadPart;
+    map_view(path, PAGE_READONLY, FILE_MAP_READ);
+#else
+    fd_ = ::open(path.c_str(), O_RDONLY);
+    if (fd_ < 0) fail("cannot open", path);
+    struct stat st;
+    if (fstat(fd_, &st) != 0) fail("cannot read the size of", path);
+    size_ = (std::size_t)st.st_size;
+    map_view(path, PROT_READ);
+#endif
+  }
+
+  // Creates (or truncates) path to size bytes and maps it for writing.
+  void create(const std::string& path, std::size_t size) {
+    close();
+    size_ = size;
+#ifdef _WIN32
+    file_ = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr, CREATE_ALWAYS,
+                        FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE) fail("cannot create", path);
+    map_view(path, PAGE_READWRITE, FILE_MAP_WRITE);
+#else
+    fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd_ < 0) fail("cannot create", path);
+    if (ftruncate(fd_, (off_t)size) != 0) fail("cannot resize", path);
+    map_view(path, PROT_READ | PROT_WRITE);
+#endif
+  }
+
+  // size bytes of zeroed memory, backed by the swap rather than a file.
+  void anonymous(std::size_t size) {
+    close();
+    size_ = size;
+    if (size == 0) return;
+#ifdef _WIN32
+    data_ = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!data_) throw std::runtime_error("cannot allocate the rank table");
+    virtual_alloc_ = true;
+#else
+    void* p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) throw std::runtime_error("cannot allocate the rank table");
+    data_ = p;
+#endif
+  }
+
+  // Hints that [offset, offset + length) will be read once, in order.
+  void advise_sequential(std::size_t offset, std::size_t length) const {
+#ifndef _WIN32
+    if (!data_ || length == 0) return;
+    long page = sysconf(_SC_PAGESIZE);
+    std::size_t start = offset - offset % page;
+    madvise(static_cast<char*>(data_) + start, length + (offset - start), MADV_SEQUENTIAL);
+#else
+    (void)offset;
+    (void)length;
+#endif
+  }
+
+  const unsigned char* data() const { return static_cast<const unsigned char*>(data_); }
+  unsigned char* data() { return static_cast<unsigned char*>(data_); }
+  std::size_t size() const { return size_; }
+
+  void close() {
+#ifdef _WIN32
+    if (data_) virtual_alloc_ ? (void)VirtualFree(data_, 0, MEM_RELEASE) : (void)UnmapViewOfFile(data_);
+    if (mapping_) CloseHandle(mapping_);
+    if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+    mapping_ = nullptr;
+    file_ = INVALID_HANDLE_VALUE;
+    virtual_alloc_ = false;
+#else
+    if (data_) munmap(data_, size_);
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+    size_ = 0;
+  }
+
+private:
+  void fail(const char* what, const std::string& path) {
+    close();
+    throw std::runtime_error(std::string(what) + " '" + path + "'");
+  }
+
+#ifdef _WIN32
+  void map_view(const std::string& path, DWORD protect, DWORD access) {
+    if (size_ == 0) return;
+    mapping_ = CreateFileMappingA(file_, nullptr, protect, (DWORD)((uint64_t)size_ >> 32),
+                                  (DWORD)(size_ & 0xffffffffu), nullptr);
+    if (!mapping_) fail("cannot map", path);
+    data_ = MapViewOfFile(mapping_, access, 0, 0, size_);
+    if (!data_) fail("cannot map", path);
+  }
+
+  HANDLE file_ = INVALID_HANDLE_VALUE;
+  HANDLE mapping_ = nullptr;
+  bool virtual_alloc_ = false;
+#else
+  void map_view(const std::string& path, int protect) {
+    if (size_ == 0) return;
+    void* p = mmap(nullptr, size_, protect, MAP_SHARED, fd_, 0);
+    if (p == MAP_FAILED) fail("cannot map", path);
+    data_ = p;
+  }
+
+  int fd_ = -1;
+#endif
+  void* data_ = nullptr;
+  std::size_t size_ = 0;
+};
+
+// Writes a preference file side by side. The caller gives every list of
+// the men, in order, then every list of the women; ids are 0-based.
+// Entries go through a small buffer, so a file of any size is written in
+// constant memory.
+class PrefFileWriter {
+public:
+  // Without lengths every list has n entries. With lengths (the men's,
+  // then the women's: 2 n values, known up front) lists may be shorter and
+  // the file is truncated.
+  PrefFileWriter(const std::string& path, int n, const std::vector<uint64_t>* lengths = nullptr)
+      : n_(n), index_bytes_(n <= 65535 ? 2 : 4), truncated_(lengths != nullptr) {
+    out_ = std::fopen(path.c_str(), "wb");
+    if (!out_) throw std::runtime_error("cannot create '" + path + "'");
+    std::memset(&header_, 0, sizeof header_);
+    std::memcpy(header_.magic, pref_file_magic, sizeof header_.magic);
+    header_.version = pref_file_version;
+    header_.byte_order = pref_file_byte_order;
+    header_.n = (uint64_t)n;
+    header_.index_bytes = index_bytes_;
+    header_.flags = truncated_ ? pref_file_truncated : 0;
+
+    uint64_t men_entries = (uint64_t)n * n, women_entries = (uint64_t)n * n;
+    if (truncated_) {
+      men_entries = women_entries = 0;
+      for (int a = 0; a < n; a++) {
+        men_entries += (*lengths)[a];
+        women_entries += (*lengths)[n + a];
+      }
+    }
+    header_.men_offset = sizeof(PrefFileHeader);
+    header_.women_offset = align(header_.men_offset + side_bytes(men_entries));
+    header_.file_size = header_.women_offset + side_bytes(women_entries);
+    put(&header_, sizeof header_);
+
+    lengths_ = lengths;
+    if (truncated_) write_starts(lengths->data());
+    if (n_ == 0) start_women_side();
+  }
+
+  ~PrefFileWriter() {
+    if (out_) std::fclose(out_);
+  }
+
+  // Appends the next list (men first, then women).
+  void add_list(const int* ids, std::size_t length) {
+    if (lists_ == 2 * n_) throw std::runtime_error("preference file: too many lists");
+    uint64_t expected = truncated_ ? (*lengths_)[lists_] : (uint64_t)n_;
+    if (length != expected) throw std::runtime_error("preference file: list length does not match");
+    if (index_bytes_ == 2) {
+      narrow_.assign(ids, ids + length);
+      put(narrow_.data(), 2 * length);
+    } else {
+      put(ids, 4 * length);
+    }
+    if (++lists_ == n_) start_women_side();
+  }
+
+  uint64_t file_size() const { return header_.file_size; }
+
+  void finish() {
+    if (lists_ != 2 * n_) throw std::runtime_error("preference file: missing lists");
+    flush();
+    if (std::fclose(out_) != 0) {
+      out_ = nullptr;
+      throw std::runtime_error("preference file: write failed");
+    }
+    out_ = nullptr;
+  }
+
+private:
+  static uint64_t align(uint64_t offset) { return (offset + 7) / 8 * 8; }
+
+  uint64_t side_bytes(uint64_t entries) const {
+    return (truncated_ ? 8 * ((uint64_t)n_ + 1) : 0) + entries * index_bytes_;
+  }
+
+  // End of the men's side: pad, then the offsets of the women's lists
+  void start_women_side() {
+    pad_to(header_.women_offset);
+    if (truncated_) write_starts(lengths_->data() + n_);
+  }
+
+  void write_starts(const uint64_t* lengths) {
+    uint64_t start = 0;
+    put(&start, 8);
+    for (int a = 0; a < n_; a++) {
+      start += lengths[a];
+      put(&start, 8);
+    }
+  }
+
+  void pad_to(uint64_t offset) {
+    const char zero[8] = {0};
+    if (written_ < offset) put(zero, offset - written_);
+  }
+
+  void put(const void* p, std::size_t bytes) {
+    const char* c = static_cast<const char*>(p);
+    buffer_.insert(buffer_.end(), c, c + bytes);
+    written_ += bytes;
+    if (buffer_.size() >= (1 << 20)) flush();
+  }
+
+  void flush() {
+    if (!buffer_.empty() && std::fwrite(buffer_.data(), 1, buffer_.size(), out_) != buffer_.size()) {
+      throw std::runtime_error("preference file: write failed");
+    }
+    buffer_.clear();
+  }
+
+  int n_;
+  uint32_t index_bytes_;
+  bool truncated_;
+  const std::vector<uint64_t>* lengths_ = nullptr;
+  PrefFileHeader header_;
+  std::FILE* out_ = nullptr;
+  std::vector<char> buffer_;
+  std::vector<uint16_t> narrow_;
+  uint64_t written_ = 0;
+  int lists_ = 0;
+};
+
+// Bucket engine view of a mapped preference file (see gs_bucket_solve()).
+// Men's lists are read in place, and checked there; the rank table is
+// filled by build_ranks().
+template <typename Index>
+class MappedPreferences {
+public:
+  typedef Index index_type;
+
+  // Checks the header and the side bounds of file; the lists themselves are
+  // checked by man_choice() and build_ranks().
+  explicit MappedPreferences(const MappedFile& file) {
+    const unsigned char* base = file.data();
+    if (file.size() < sizeof(PrefFileHeader)) bad("file is too short for a header");
+    std::memcpy(&header_, base, sizeof header_);
+    if (std::memcmp(header_.magic, pref_file_magic, sizeof header_.magic) != 0) {
+      bad("not a preference file");
+    }
+    if (header_.byte_order != pref_file_byte_order) bad("written with another byte order");
+    if (header_.version != pref_file_version) bad("unsupported version");
+    if (header_.index_bytes != sizeof(Index)) bad("index width does not match n");
+    if (header_.n > 0x7fffffff) bad("n is too large");
+    if (header_.file_size != file.size()) bad("file size does not match its header");
+    n_ = (int)header_.n;
+    read_side(base, file.size(), header_.men_offset, men_start_, men_);
+    read_side(base, file.size(), header_.women_offset, women_start_, women_);
+  }
+
+  int size() const { return n_; }
+  bool truncated() const { return (header_.flags & pref_file_truncated) != 0; }
+  int list_length(int h) const { return (int)(men_start_[h + 1] - men_start_[h]); }
+  int man_choice(int h, int k) const {
+    int f = men_[men_start_[h] + k];
+    if (f >= n_) bad_list("man", h);
+    return f;
+  }
+  int woman_rank(int f, int h) const { return ranks_[(std::size_t)f * n_ + h]; }
+
+  // Fills the rank table (n x n Index, lower = better) from the women's
+  // lists in one sequential pass, each row being written once: a stamp per
+  // man catches ids out of range or twice, and a truncated list first sets
+  // its row to n. Throws on the first bad list.
+  void build_ranks(Index* ranks) {
+    ranks_ = ranks;
+    std::vector<int> seen(n_, -1);
+    for (int f = 0; f < n_; f++) {
+      Index* rank = ranks + (std::size_t)f * n_;
+      const uint64_t first = women_start_[f], last = women_start_[f + 1];
+      if (last - first < (uint64_t)n_) std::fill(rank, rank + n_, (Index)n_);
+      for (uint64_t k = first; k < last; k++) {
+        int h = women_[k];
+        if (h >= n_ || seen[h] == f) bad_list("woman", f);
+        seen[h] = f;
+        rank[h] = (Index)(k - first);
+      }
+    }
+  }
+
+  uint64_t women_offset() const { return header_.women_offset; }
+  uint64_t women_bytes() const { return header_.file_size - header_.women_offset; }
+
+private:
+  static void bad(const char* what) { throw std::runtime_error(std::string("preference file: ") + what); }
+
+  [[noreturn]] static void bad_list(const char* agent, int a) {
+    throw std::runtime_error(std::string("preference file: the list of ") + agent + " " +
+                             std::to_string(a + 1) + " has an id out of range or twice");
+  }
+
+  void read_side(const unsigned char* base, std::size_t file_size, uint64_t offset,
+                 std::vector<uint64_t>& start, const Index*& ids) {
+    start.resize(n_ + 1);
+    if (offset % 8 != 0 || offset > file_size) bad("side offset out of range");
+    if (truncated()) {
+      if (offset + 8 * ((uint64_t)n_ + 1) > file_size) bad("list offsets out of range");
+      std::memcpy(start.data(), base + offset, 8 * ((std::size_t)n_ + 1));
+      offset += 8 * ((uint64_t)n_ + 1);
+      for (int a = 0; a < n_; a++) {
+        if (start[a + 1] < start[a] || start[a + 1] - start[a] > (uint64_t)n_) bad("bad list offsets");
+      }
+      if (start[0] != 0) bad("bad list offsets");
+    } else {
+      for (int a = 0; a <= n_; a++) start[a] = (uint64_t)a * n_;
+    }
+    if (offset + start[n_] * sizeof(Index) > file_size) bad("lists run past the end of the file");
+    ids = reinterpret_cast<const Index*>(base + offset);
+  }
+
+  PrefFileHeader header_;
+  int n_ = 0;
+  std::vector<uint64_t> men_start_, women_start_;
+  const Index* men_ = nullptr;
+  const Index* women_ = nullptr;
+  const Index* ranks_ = nullptr;
+};
+
+// Solves the instance of the preference file at path with the bucket
+// engine. The rank table goes to anonymous memory, or to a scratch file at
+// rank_path (removed afterwards) when it should not take up RAM. Fills
+// matching[h] with the woman of man h (-1 if unmatched) and returns the
+// number of proposals.
+inline long long gs_solve_pref_file(const std::string& path, const std::string& rank_path,
+                                    std::vector<int>& matching) {
+  MappedFile file;
+  file.open_read(path);
+  if (file.size() < sizeof(PrefFileHeader)) {
+    throw std::runtime_error("preference file: file is too short for a header");
+  }
+  PrefFileHeader header;
+  std::memcpy(&header, file.data(), sizeof header);
+  long long proposals = 0;
+  dispatch_index_width(header.n > 65535 ? 65536 : (int)header.n, [&](auto index_type) {
+    using Index = decltype(index_type);
+    MappedPreferences<Index> prefs(file);
+    const int n = prefs.size();
+
+    // The scratch file goes once unmapped, on errors too
+    struct ScratchFile {
+      std::string path;
+      ~ScratchFile() {
+        if (!path.empty()) std::remove(path.c_str());
+      }
+    } scratch{rank_path};
+    MappedFile ranks;
+    const std::size_t rank_bytes = (std::size_t)n * n * sizeof(Index);
+    if (rank_path.empty()) {
+      ranks.anonymous(rank_bytes);
+    } else {
+      ranks.create(rank_path, rank_bytes);
+    }
+    file.advise_sequential(prefs.women_offset(), prefs.women_bytes());
+    prefs.build_ranks(reinterpret_cast<Index*>(ranks.data()));
+    proposals = gs_bucket_solve(prefs, matching);
+  });
+  return proposals;
+}
+
+#endif
@@ -0,0 +1,108 @@
+// Round-based parallel Gale-Shapley (McVitie-Wilson style).
+//
+// In every round all free men propose to the next woman on their list at
+// the same time. Each woman keeps an atomic 64-bit key (rank << 32 | man) of
+// the best man holding or proposing to her, updated with a compare-and-swap
+// minimum, so acceptance needs no lock. A round is equivalent to the serial
+// algorithm processing the same proposals one by one, which is why the
+// result is the same man-optimal matching as gs_bucket_solve().
+//
+// When only a few men are left free the rounds become too small to pay for
+// a barrier, and the remaining proposals are finished serially on the same
+// state.
+#ifndef CHT_GS_PARALLEL_ENGINE_H
+#define CHT_GS_PARALLEL_ENGINE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "gs_bucket_engine.h"
+#include "worker_pool.h"
+
+// Fills matching[h] with the woman of man h; returns the number of proposals.
+template <typename Index>
+long long gs_parallel_solve(const PreferenceStore<Index>& prefs, std::vector<int>& matching,
+                            WorkerPool& pool) {
+  const int n = prefs.size();
+  const int n_threads = pool.size();
+  const uint64_t empty_key = ~uint64_t(0);
+  const std::size_t serial_below = 256 * (std::size_t)n_threads;
+
+  matching.assign(n, -1);
+  std::vector<int> next_choice(n, 0);
+  std::vector<int> fiance(n, -1);
+  std::vector<std::atomic<uint64_t>> best(n);
+  for (int f = 0; f < n; f++) best[f].store(empty_key, std::memory_order_relaxed);
+
+  std::vector<int> free_men(n);
+  for (int h = 0; h < n; h++) free_men[h] = h;
+  std::vector<std::vector<int>> next_free(n_threads);
+  std::vector<long long> proposals(n_threads, 0);
+
+  while (free_men.size() >= serial_below) {
+    // Proposal round: lower key wins, the holder's key is already in best[f]
+    pool.parallel_for(free_men.size(), [&](std::size_t begin, std::size_t end, int t) {
+      for (std::size_t i = begin; i < end; i++) {
+        int h = free_men[i];
+        int f = prefs.men_pref(h)[next_choice[h]];
+        uint64_t key = ((uint64_t)prefs.women_rank(f)[h] << 32) | (uint32_t)h;
+        uint64_t current = best[f].load(std::memory_order_relaxed);
+        while (key < current &&
+               !best[f].compare_exchange_weak(current, key, std::memory_order_relaxed)) {
+        }
+      }
+      proposals[t] += end - begin;
+    });
+
+    // Resolution: exactly one proposer per woman can find itself in best[f]
+    pool.parallel_for(free_men.size(), [&](std::size_t begin, std::size_t end, int t) {
+      std::vector<int>& out = next_free[t];
+      out.clear();
+      for (std::size_t i = begin; i < end; i++) {
+        int h = free_men[i];
+        int f = prefs.men_pref(h)[next_choice[h]];
+        int winner = (int)(best[f].load(std::memory_order_relaxed) & 0xffffffffu);
+        int loser = h;
+        if (winner == h) {
+          loser = fiance[f];
+          fiance[f] = h;
+          matching[h] = f;
+          if (loser != -1) matching[loser] = -1;
+        }
+        if (loser != -1 && ++next_choice[loser] < n) out.push_back(loser);
+      }
+    });
+
+    free_men.clear();
+    for (auto& out : next_free) free_men.insert(free_men.end(), out.begin(), out.end());
+  }
+
+  // Serial tail on the same state
+  long long total = 0;
+  for (long long p : proposals) total += p;
+  while (!free_men.empty()) {
+    int h = free_men.back();
+    int f = prefs.men_pref(h)[next_choice[h]];
+    total++;
+    int current = fiance[f];
+    int loser = h;
+    if (current == -1 || prefs.women_rank(f)[h] < prefs.women_rank(f)[current]) {
+      fiance[f] = h;
+      matching[h] = f;
+      loser = current;
+      free_men.pop_back();
+      if (loser != -1) {
+        matching[loser] = -1;
+        free_men.push_back(loser);
+      }
+    }
+    if (loser != -1 && ++next_choice[loser] >= n) {
+      free_men.pop_back();
+    }
+  }
+
+  return total;
+}
+
+#endif
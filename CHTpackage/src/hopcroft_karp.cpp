@@ -1,47 +1,58 @@
 #include <Rcpp.h>
-#include <queue>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <limits>
 #include <unordered_map>
-#include <unordered_set>
 #include <vector>
 #include <string>
-#include <limits>
+#include "antigen_graph.h"
+#include "auction_engine.h"
+#include "bipartite_matching.h"
+#include "blood_types.h"
+#include "class_matching_engine.h"
+#include "matching_verifier.h"
+#include "parallel_matching_engine.h"
 
 using namespace Rcpp;
 
-// Structure pour stocker les résultats du BFS
-struct BFSResult {
-  bool found;
-  std::unordered_map<std::string, double> distance;
-};
-
-// Structure pour stocker les résultats du DFS
-struct DFSResult {
-  bool success;
-  std::unordered_map<std::string, int> matching_donor;
-  std::unordered_map<std::string, int> matching_receiver;
-  std::unordered_map<std::string, double> distance;
-};
-
-// Fonction pour vérifier la compatibilité (fonction interne, pas exportée)
-bool can_receive_cpp(const std::string& donor_type,
-                     const std::string& recipient_type,
-                     const NumericMatrix& compatibility_table,
-                     const CharacterVector& blood_types) {
-  int donor_idx = -1, recipient_idx = -1;
-
-  for (int i = 0; i < blood_types.size(); i++) {
-    if (std::string(blood_types[i]) == donor_type) donor_idx = i;
-    if (std::string(blood_types[i]) == recipient_type) recipient_idx = i;
+// Graphe CSR en liste nommée par identifiant de donneur (format historique)
+static List graph_as_list(const BipartiteGraph& csr, const IntegerVector& donors,
+                          const IntegerVector& receivers) {
+  int n_donors = donors.size();
+  List graph(n_donors);
+  CharacterVector donor_keys(n_donors);
+  for (int i = 0; i < n_donors; i++) {
+    donor_keys[i] = std::to_string(donors[i]);
+    IntegerVector compatible_receivers(csr.start[i + 1] - csr.start[i]);
+    for (int64_t e = csr.start[i]; e < csr.start[i + 1]; e++) {
+      compatible_receivers[e - csr.start[i]] = receivers[csr.adj[e]];
+    }
+    graph[i] = compatible_receivers;
   }
+  graph.names() = donor_keys;
+  return graph;
+}
 
-  if (donor_idx == -1 || recipient_idx == -1) return false;
-
-  return compatibility_table(donor_idx, recipient_idx) == 1;
+// Graphe CSR compact : start (décalages, base 0) et adj (positions des
+// receveurs, base 1)
+static List graph_as_csr(const BipartiteGraph& csr) {
+  NumericVector start(csr.start.begin(), csr.start.end());
+  IntegerVector adj(csr.adj.size());
+  for (std::size_t e = 0; e < csr.adj.size(); e++) adj[e] = csr.adj[e] + 1;
+  return List::create(
+    Named("start") = start,
+    Named("adj") = adj
+  );
 }
 
 //' Build Compatibility Graph
  //'
- //' Constructs a compatibility graph for blood type matching
+ //' Constructs a compatibility graph for blood type matching. Receivers are
+ //' grouped by blood type first, so each donor's list is a copy of the
+ //' receivers of its compatible types rather than a test of every pair.
  //'
  //' @param donors Integer vector of donor IDs
  //' @param receivers Integer vector of receiver IDs
@@ -56,222 +67,637 @@ bool can_receive_cpp(const std::string& donor_type,
                                     const DataFrame& data,
                                     const NumericMatrix& compatibility_table,
                                     const CharacterVector& blood_types) {
-   CharacterVector blood_type_col = data["blood_type"];
-   List graph;
-
-   for (int i = 0; i < donors.size(); i++) {
-     int donor_id = donors[i];
-     std::string donor_type = std::string(blood_type_col[donor_id - 1]);
-     IntegerVector compatible_receivers;
-
-     for (int j = 0; j < receivers.size(); j++) {
-       int receiver_id = receivers[j];
-       std::string receiver_type = std::string(blood_type_col[receiver_id - 1]);
-
-       if (can_receive_cpp(donor_type, receiver_type, compatibility_table, blood_types)) {
-         compatible_receivers.push_back(receiver_id);
-       }
-     }
-
-     std::string key = std::to_string(donor_id);
-     graph[key] = compatible_receivers;
-   }
-
-   return graph;
+   // Graphe CSR par groupes sanguins, puis liste nommée par donneur
+   SEXP blood_type_col = data["blood_type"];
+   BipartiteGraph csr;
+   build_class_graph(blood_types.size(), compatible_types(compatibility_table, blood_types),
+                     blood_classes(donors, blood_type_col, blood_types),
+                     blood_classes(receivers, blood_type_col, blood_types), csr);
+
+   return graph_as_list(csr, donors, receivers);
  }
 
-// BFS pour trouver des chemins augmentants (fonction interne)
-BFSResult bfs_hopcroft_karp_cpp(const List& graph,
-                                const IntegerVector& donors,
-                                const std::unordered_map<std::string, int>& matching_donor,
-                                const std::unordered_map<std::string, int>& matching_receiver) {
-  std::unordered_map<std::string, double> distance;
-  std::queue<int> queue;
-
-  for (int i = 0; i < donors.size(); i++) {
-    int donor = donors[i];
-    std::string donor_key = std::to_string(donor);
-
-    auto it = matching_donor.find(donor_key);
-    if (it == matching_donor.end() || it->second == NA_INTEGER) {
-      distance[donor_key] = 0;
-      queue.push(donor);
-    } else {
-      distance[donor_key] = std::numeric_limits<double>::infinity();
+// Lit une matrice agents x antigènes (logique ou numérique) en masques de
+// n_words mots de 64 bits par agent ; NA et 0 valent absent.
+static std::vector<uint64_t> antigen_masks(SEXP matrix, int n_words, const char* what) {
+  if (!Rf_isMatrix(matrix)) stop("%s must be a matrix", what);
+  int n_agents = Rf_nrows(matrix), n_antigens = Rf_ncols(matrix);
+  std::vector<uint64_t> masks((std::size_t)n_agents * n_words, 0);
+  auto set = [&](int i, int k) { masks[(std::size_t)i * n_words + k / 64] |= uint64_t(1) << (k % 64); };
+  if (TYPEOF(matrix) == LGLSXP || TYPEOF(matrix) == INTSXP) {
+    const int* x = TYPEOF(matrix) == LGLSXP ? LOGICAL(matrix) : INTEGER(matrix);
+    for (int k = 0; k < n_antigens; k++) {
+      for (int i = 0; i < n_agents; i++) {
+        int v = x[(std::size_t)k * n_agents + i];
+        if (v != NA_INTEGER && v != 0) set(i, k);
+      }
+    }
+  } else if (TYPEOF(matrix) == REALSXP) {
+    const double* x = REAL(matrix);
+    for (int k = 0; k < n_antigens; k++) {
+      for (int i = 0; i < n_agents; i++) {
+        double v = x[(std::size_t)k * n_agents + i];
+        if (!std::isnan(v) && v != 0) set(i, k);
+      }
     }
+  } else {
+    stop("%s must be a logical or numeric matrix", what);
   }
+  return masks;
+}
 
-  distance["NIL"] = std::numeric_limits<double>::infinity();
-
-  while (!queue.empty()) {
-    int donor = queue.front();
-    queue.pop();
+//' Build an Antigen Compatibility Graph
+ //'
+ //' Builds the donor x receiver compatibility graph of an extended antigen
+ //' panel (ABO, RhD, Kell, Duffy, Kidd, HLA...). Donor i may give to
+ //' receiver j iff no antigen of i meets an antibody of j. The panel is
+ //' packed into 64-bit masks and the graph is built with bitset operations
+ //' (64 pairs per word operation, donors with the same antigens computed
+ //' once), directly in compressed sparse row (CSR) form.
+ //'
+ //' @param donor_antigens Logical or 0/1 matrix, one row per donor and one
+ //'   column per antigen of the panel (TRUE: the donor carries it)
+ //' @param receiver_antibodies Logical or 0/1 matrix, one row per receiver
+ //'   and the same columns (TRUE: the receiver has antibodies against it)
+ //' @param threads Number of threads
+ //' @return A list with start (numeric, length donors + 1) and adj (integer
+ //'   receiver row numbers): the receivers of donor i are
+ //'   adj[start[i] + seq_len(start[i + 1] - start[i])]
+ //' @export
+ // [[Rcpp::export]]
+ List build_antigen_graph_cpp(SEXP donor_antigens, SEXP receiver_antibodies, int threads = 1) {
+   if (threads < 1) stop("threads must be at least 1");
+   if (!Rf_isMatrix(donor_antigens) || !Rf_isMatrix(receiver_antibodies)) {
+     stop("donor_antigens and receiver_antibodies must be matrices");
+   }
+   int n_antigens = Rf_ncols(donor_antigens);
+   if (Rf_ncols(receiver_antibodies) != n_antigens) {
+     stop("donor_antigens and receiver_antibodies must have the same antigen columns");
+   }
+   auto column_names = [](SEXP matrix) {
+     SEXP dimnames = Rf_getAttrib(matrix, R_DimNamesSymbol);
+     return Rf_isNull(dimnames) ? R_NilValue : VECTOR_ELT(dimnames, 1);
+   };
+   SEXP donor_names = column_names(donor_antigens);
+   SEXP receiver_names = column_names(receiver_antibodies);
+   if (!Rf_isNull(donor_names) && !Rf_isNull(receiver_names) &&
+       !R_compute_identical(donor_names, receiver_names, 16)) {
+     stop("donor_antigens and receiver_antibodies must have the same antigen columns");
+   }
 
-    std::string donor_key = std::to_string(donor);
+   int n_words = std::max(1, (n_antigens + 63) / 64);
+   std::vector<uint64_t> antigens = antigen_masks(donor_antigens, n_words, "donor_antigens");
+   std::vector<uint64_t> antibodies = antigen_masks(receiver_antibodies, n_words, "receiver_antibodies");
+   WorkerPool pool(threads);
+   BipartiteGraph csr;
+   build_antigen_graph(antigens, antibodies, n_words, pool, csr);
 
-    if (distance[donor_key] < distance["NIL"]) {
-      IntegerVector adjacent_receivers = graph[donor_key];
+   return graph_as_csr(csr);
+ }
 
-      for (int j = 0; j < adjacent_receivers.size(); j++) {
-        int receiver = adjacent_receivers[j];
-        std::string receiver_key = std::to_string(receiver);
+// Couplage maximum par flot sur le réseau des groupes sanguins (method = "class_flow")
+static List class_flow_matching_cpp(const IntegerVector& donors,
+                                    const IntegerVector& receivers,
+                                    const DataFrame& data,
+                                    const NumericMatrix& compatibility_table,
+                                    const CharacterVector& blood_types) {
+  int n_types = blood_types.size();
+  std::vector<char> compatible = compatible_types(compatibility_table, blood_types);
 
-        std::string paired_donor_key = "NIL";
-        auto it = matching_receiver.find(receiver_key);
-        if (it != matching_receiver.end() && it->second != NA_INTEGER) {
-          paired_donor_key = std::to_string(it->second);
-        }
+  SEXP blood_type_col = data["blood_type"];
+  std::vector<int> donor_class = blood_classes(donors, blood_type_col, blood_types);
+  std::vector<int> receiver_class = blood_classes(receivers, blood_type_col, blood_types);
 
-        if (distance.find(paired_donor_key) == distance.end() ||
-            std::isinf(distance[paired_donor_key])) {
-          distance[paired_donor_key] = distance[donor_key] + 1;
+  std::vector<int> match_donor, match_receiver;
+  std::vector<long long> class_flow;
+  long long matching_size = class_flow_matching(n_types, compatible, donor_class, receiver_class,
+                                                match_donor, match_receiver, class_flow);
 
-          if (paired_donor_key != "NIL") {
-            queue.push(std::stoi(paired_donor_key));
-          }
-        }
-      }
-    }
+  IntegerVector matching_donor(donors.size());
+  for (int i = 0; i < donors.size(); i++) {
+    matching_donor[i] = match_donor[i] == -1 ? NA_INTEGER : receivers[match_donor[i]];
   }
-
-  BFSResult result;
-  result.found = !std::isinf(distance["NIL"]);
-  result.distance = distance;
-
-  return result;
+  IntegerVector matching_receiver(receivers.size());
+  for (int j = 0; j < receivers.size(); j++) {
+    matching_receiver[j] = match_receiver[j] == -1 ? NA_INTEGER : donors[match_receiver[j]];
+  }
+  NumericMatrix flow(n_types, n_types);
+  for (int d = 0; d < n_types; d++) {
+    for (int r = 0; r < n_types; r++) flow(d, r) = (double)class_flow[(std::size_t)d * n_types + r];
+  }
+  flow.attr("dimnames") = List::create(blood_types, blood_types);
+
+  return List::create(
+    Named("matching_donor") = matching_donor,
+    Named("matching_receiver") = matching_receiver,
+    Named("matching_size") = (int)matching_size,
+    Named("class_flow") = flow
+  );
 }
 
-// DFS pour trouver et appliquer un chemin augmentant (fonction interne)
-DFSResult dfs_hopcroft_karp_cpp(int donor,
-                                const List& graph,
-                                std::unordered_map<std::string, double>& distance,
-                                std::unordered_map<std::string, int>& matching_donor,
-                                std::unordered_map<std::string, int>& matching_receiver) {
-  DFSResult result;
-  result.matching_donor = matching_donor;
-  result.matching_receiver = matching_receiver;
-  result.distance = distance;
-
-  if (donor != NA_INTEGER) {
-    std::string donor_key = std::to_string(donor);
-    IntegerVector adjacent_receivers = graph[donor_key];
-
-    for (int i = 0; i < adjacent_receivers.size(); i++) {
-      int receiver = adjacent_receivers[i];
-      std::string receiver_key = std::to_string(receiver);
-
-      std::string paired_donor_key = "NIL";
-      int paired_donor = NA_INTEGER;
-      auto it = matching_receiver.find(receiver_key);
-      if (it != matching_receiver.end() && it->second != NA_INTEGER) {
-        paired_donor = it->second;
-        paired_donor_key = std::to_string(paired_donor);
-      }
+// Couplage fourni par l'appelant : initial[i] est l'identifiant du receveur
+// de donors[i] (NA si libre). Chaque paire doit être une arête du graphe ;
+// arg nomme l'argument dans les messages d'erreur.
+static void read_initial_matching(const IntegerVector& initial, const char* arg,
+                                  const IntegerVector& donors,
+                                  const IntegerVector& receivers,
+                                  const BipartiteGraph& csr,
+                                  std::vector<int>& match_donor,
+                                  std::vector<int>& match_receiver) {
+  if (initial.size() != donors.size()) stop("%s must have one entry per donor", arg);
+  std::unordered_map<int, int> receiver_index;
+  receiver_index.reserve(receivers.size());
+  for (int j = 0; j < receivers.size(); j++) receiver_index.emplace(receivers[j], j);
 
-      if (distance[paired_donor_key] == distance[donor_key] + 1) {
-        DFSResult dfs_result = dfs_hopcroft_karp_cpp(paired_donor, graph, distance,
-                                                     matching_donor, matching_receiver);
-
-        if (dfs_result.success) {
-          dfs_result.matching_receiver[receiver_key] = donor;
-          dfs_result.matching_donor[donor_key] = receiver;
-          return dfs_result;
-        } else {
-          matching_donor = dfs_result.matching_donor;
-          matching_receiver = dfs_result.matching_receiver;
-          distance = dfs_result.distance;
-        }
-      }
-    }
-
-    distance[donor_key] = std::numeric_limits<double>::infinity();
-    result.success = false;
-    result.matching_donor = matching_donor;
-    result.matching_receiver = matching_receiver;
-    result.distance = distance;
-    return result;
+  for (int i = 0; i < donors.size(); i++) {
+    if (initial[i] == NA_INTEGER) continue;
+    auto it = receiver_index.find(initial[i]);
+    if (it == receiver_index.end()) stop("%s: %d is not a receiver", arg, initial[i]);
+    int j = it->second;
+    if (match_receiver[j] != -1) stop("%s: receiver %d is matched twice", arg, initial[i]);
+    bool is_edge = false;
+    for (int64_t e = csr.start[i]; e < csr.start[i + 1] && !is_edge; e++) is_edge = csr.adj[e] == j;
+    if (!is_edge) stop("%s: donor %d cannot give to receiver %d", arg, donors[i], initial[i]);
+    match_donor[i] = j;
+    match_receiver[j] = i;
   }
+}
 
-  result.success = true;
-  return result;
+// Compteurs d'une recherche instrumentée, pour l'attribut "stats"
+static List search_stats(const SolverStats& solver_stats, double seconds) {
+  std::vector<int> lengths;
+  std::vector<double> counts;
+  for (std::size_t k = 0; k < solver_stats.path_count.size(); k++) {
+    if (solver_stats.path_count[k] == 0) continue;
+    lengths.push_back((int)k);
+    counts.push_back((double)solver_stats.path_count[k]);
+  }
+  return List::create(
+    Named("phases") = solver_stats.phases,
+    Named("path_lengths") = DataFrame::create(
+      Named("length") = wrap(lengths),
+      Named("paths") = wrap(counts)
+    ),
+    Named("phase_seconds") = wrap(solver_stats.phase_seconds),
+    Named("seconds") = seconds
+  );
 }
 
 //' Hopcroft-Karp Maximum Bipartite Matching Algorithm
  //'
  //' C++ implementation of the Hopcroft-Karp algorithm for finding maximum matching
- //' in bipartite graphs, specifically for blood donation matching.
+ //' in bipartite graphs, specifically for blood donation matching. The graph is
+ //' stored as a CSR adjacency over dense donor/receiver indices and the search
+ //' updates the matching in place, so a run is O(E sqrt(V)).
  //'
  //' @param donors Integer vector of donor IDs
  //' @param receivers Integer vector of receiver IDs
  //' @param data DataFrame containing donor and receiver information including blood types
  //' @param compatibility_table Numeric matrix representing blood type compatibility (1 for compatible, 0 for not)
  //' @param blood_types Character vector of blood types corresponding to the compatibility table
- //' @return A list containing matching_donor, matching_receiver, matching_size, and graph
+ //' @param method "graph" (default) runs Hopcroft-Karp on the explicit donor x
+ //'   receiver graph. "parallel" runs the same phases on several threads
+ //'   (level-synchronous BFS, vertex-disjoint augmenting paths claimed
+ //'   atomically), falling back to the serial search on small graphs or when
+ //'   threads block each other. "class_flow" uses the fact that compatibility only
+ //'   depends on the blood types: it solves a max flow on the small
+ //'   type x type network and then assigns concrete ids type by type, in
+ //'   O(donors + receivers) without building the graph
+ //' @param warm_start Heuristic run before the phase loop of the "graph"
+ //'   and "parallel" methods: "none" (default), "greedy" (first free
+ //'   receiver of each donor) or "karp_sipser" (receivers or donors with a
+ //'   single free neighbour first). It extends the initial matching when
+ //'   one is given
+ //' @param initial Optional initial matching for the "graph" and "parallel"
+ //'   methods: an integer vector aligned with donors giving each donor's
+ //'   receiver id, NA for a free donor
+ //' @param compare_cold If TRUE, the "graph" and "parallel" methods also
+ //'   solve from an empty matching to report phases_saved (this doubles the
+ //'   search time)
+ //' @param threads Number of threads of the "parallel" method
+ //' @param output "list" (default) returns matching_donor and matching_receiver
+ //'   as lists named by id. "vector" returns integer vectors aligned with
+ //'   donors and receivers (the partner's id, NA if unmatched), built in one
+ //'   pass, and, with return_graph = TRUE, the graph in CSR form: start
+ //'   (offsets) and adj (receiver positions), the receivers of donor i being
+ //'   adj[start[i] + seq_len(start[i + 1] - start[i])]
+ //' @param return_graph If FALSE, graph is NULL: the compatibility graph is
+ //'   not converted to R, which is usually the largest part of the output.
+ //'   By default (NULL) the graph is returned with output = "list", as it
+ //'   always was, and left out with output = "vector"
+ //' @param stats If TRUE, the "graph" and "parallel" methods time their
+ //'   phases and the result carries attribute "stats": a list with phases,
+ //'   path_lengths (a data.frame giving the number of augmenting paths per
+ //'   length in edges), phase_seconds (wall time of each phase) and seconds
+ //'   (whole search). Without it, the search runs without any
+ //'   instrumentation
+ //' @return A list containing matching_donor, matching_receiver, matching_size, and graph.
+ //'   The "graph" and "parallel" methods also report warm_start_size (pairs before the first
+ //'   phase), phases and phases_saved (NA unless compare_cold = TRUE).
+ //'   With method = "class_flow", matching_donor and matching_receiver are
+ //'   integer vectors aligned with donors and receivers (the partner's id, NA
+ //'   if unmatched), and class_flow replaces graph: the number of pairs per
+ //'   (donor type, receiver type)
  //' @export
  // [[Rcpp::export]]
  List hopcroft_karp_cpp(const IntegerVector& donors,
                         const IntegerVector& receivers,
                         const DataFrame& data,
                         const NumericMatrix& compatibility_table,
-                        const CharacterVector& blood_types) {
+                        const CharacterVector& blood_types,
+                        std::string method = "graph",
+                        std::string warm_start = "none",
+                        Nullable<IntegerVector> initial = R_NilValue,
+                        bool compare_cold = false,
+                        int threads = 1,
+                        std::string output = "list",
+                        Nullable<LogicalVector> return_graph = R_NilValue,
+                        bool stats = false) {
+
+   if (method == "class_flow") {
+     return class_flow_matching_cpp(donors, receivers, data, compatibility_table, blood_types);
+   }
+   if (method != "graph" && method != "parallel") {
+     stop("unknown method '%s', expected 'graph', 'parallel' or 'class_flow'", method.c_str());
+   }
+   if (threads < 1) stop("threads must be at least 1");
+   if (output != "list" && output != "vector") {
+     stop("unknown output '%s', expected 'list' or 'vector'", output.c_str());
+   }
+   // Le graphe n'est renvoyé par défaut qu'au format historique
+   bool keep_graph = output != "vector";
+   if (return_graph.isNotNull()) {
+     LogicalVector flag(return_graph.get());
+     if (flag.size() != 1 || flag[0] == NA_LOGICAL) stop("return_graph must be TRUE, FALSE or NULL");
+     keep_graph = flag[0];
+   }
 
-   List graph = build_compatibility_graph_cpp(donors, receivers, data,
-                                              compatibility_table, blood_types);
+   // Graphe CSR sur des indices denses : donneur i = donors[i], receveur j = receivers[j]
+   SEXP blood_type_col = data["blood_type"];
+   BipartiteGraph csr;
+   build_class_graph(blood_types.size(), compatible_types(compatibility_table, blood_types),
+                     blood_classes(donors, blood_type_col, blood_types),
+                     blood_classes(receivers, blood_type_col, blood_types), csr);
+
+   // Couplage de départ : fourni par l'appelant, puis complété par l'heuristique
+   std::vector<int> match_donor(csr.n_left, -1), match_receiver(csr.n_right, -1);
+   if (initial.isNotNull()) {
+     read_initial_matching(IntegerVector(initial.get()), "initial", donors, receivers, csr,
+                           match_donor, match_receiver);
+   }
+   if (warm_start == "greedy") {
+     greedy_matching(csr, match_donor, match_receiver);
+   } else if (warm_start == "karp_sipser") {
+     karp_sipser_matching(csr, match_donor, match_receiver);
+   } else if (warm_start != "none") {
+     stop("unknown warm_start '%s', expected 'none', 'greedy' or 'karp_sipser'", warm_start.c_str());
+   }
+   int warm_start_size = 0;
+   for (int v : match_donor) warm_start_size += v != -1;
+
+   // Recherche sur un seul thread, ou sur le pool pour method = "parallel".
+   // L'instrumentation n'est compilée que dans la version SolverStats.
+   WorkerPool pool(method == "parallel" ? threads : 1);
+   auto run_engine = [&](std::vector<int>& ml, std::vector<int>& mr, int& n_phases, auto& counters) {
+     if (method == "parallel") return parallel_hopcroft_karp(csr, ml, mr, pool, counters, &n_phases);
+     HopcroftKarp engine;
+     int size = engine.augment(csr, ml, mr, counters);
+     n_phases = engine.phases();
+     return size;
+   };
+   int phases = 0;
+   SolverStats solver_stats;
+   NullStats no_stats;
+   auto start = std::chrono::steady_clock::now();
+   int matching_size = stats ? run_engine(match_donor, match_receiver, phases, solver_stats)
+                             : run_engine(match_donor, match_receiver, phases, no_stats);
+   double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+   int phases_saved = NA_INTEGER;
+   if (compare_cold) {
+     std::vector<int> cold_donor(csr.n_left, -1), cold_receiver(csr.n_right, -1);
+     int cold_phases = 0;
+     run_engine(cold_donor, cold_receiver, cold_phases, no_stats);
+     phases_saved = cold_phases - phases;
+   }
+   SEXP stats_list = R_NilValue;
+   if (stats) stats_list = search_stats(solver_stats, seconds);
+
+   int n_donors = donors.size();
+   int n_receivers = receivers.size();
+   IntegerVector matching_donor(n_donors), matching_receiver(n_receivers);
+   for (int i = 0; i < n_donors; i++) {
+     matching_donor[i] = match_donor[i] == -1 ? NA_INTEGER : receivers[match_donor[i]];
+   }
+   for (int j = 0; j < n_receivers; j++) {
+     matching_receiver[j] = match_receiver[j] == -1 ? NA_INTEGER : donors[match_receiver[j]];
+   }
+
+   SEXP graph = R_NilValue;
+   if (output == "vector") {
+     if (keep_graph) graph = graph_as_csr(csr);
+     List result = List::create(
+       Named("matching_donor") = matching_donor,
+       Named("matching_receiver") = matching_receiver,
+       Named("matching_size") = matching_size,
+       Named("graph") = graph,
+       Named("warm_start_size") = warm_start_size,
+       Named("phases") = phases,
+       Named("phases_saved") = phases_saved
+     );
+     if (stats) result.attr("stats") = stats_list;
+     return result;
+   }
 
-   std::unordered_map<std::string, int> matching_donor;
-   std::unordered_map<std::string, int> matching_receiver;
+   // Sorties au format historique : listes nommées par identifiant
+   CharacterVector donor_keys(n_donors), receiver_keys(n_receivers);
+   for (int i = 0; i < n_donors; i++) donor_keys[i] = std::to_string(donors[i]);
+   for (int j = 0; j < n_receivers; j++) receiver_keys[j] = std::to_string(receivers[j]);
+   List matching_donor_list = as<List>(matching_donor);
+   List matching_receiver_list = as<List>(matching_receiver);
+   matching_donor_list.names() = donor_keys;
+   matching_receiver_list.names() = receiver_keys;
+   if (keep_graph) graph = graph_as_list(csr, donors, receivers);
+
+   List result = List::create(
+     Named("matching_donor") = matching_donor_list,
+     Named("matching_receiver") = matching_receiver_list,
+     Named("matching_size") = matching_size,
+     Named("graph") = graph,
+     Named("warm_start_size") = warm_start_size,
+     Named("phases") = phases,
+     Named("phases_saved") = phases_saved
+   );
+   if (stats) result.attr("stats") = stats_list;
+   return result;
+ }
 
-   for (int i = 0; i < donors.size(); i++) {
-     matching_donor[std::to_string(donors[i])] = NA_INTEGER;
+//' Verify that a Matching is Maximum
+ //'
+ //' Audits the result of hopcroft_karp_cpp() in C++. The matching must only
+ //' use compatible pairs and match every receiver once; it is then maximum
+ //' exactly when no augmenting path remains (Berge), which one alternating
+ //' BFS from all free donors decides in O(V + E) on the same graph as the
+ //' solver, a fraction of the O(E sqrt(V)) search.
+ //'
+ //' @param result Output of hopcroft_karp_cpp() (any method and output
+ //'   format): only matching_donor is read
+ //' @param donors Integer vector of donor IDs, as given to the solver
+ //' @param receivers Integer vector of receiver IDs, as given to the solver
+ //' @param data DataFrame containing blood type information
+ //' @param compatibility_table Numeric matrix of blood type compatibility
+ //' @param blood_types Character vector of blood type names
+ //' @return A list with maximum (logical), matching_size and augmenting_path:
+ //'   NULL when the matching is maximum, otherwise a data.frame of the
+ //'   pairs (donor, receiver) to match along the path, the receiver of each
+ //'   row being currently matched to the donor of the next row
+ //' @export
+ // [[Rcpp::export]]
+ List hk_verify_maximum_cpp(const List& result,
+                            const IntegerVector& donors,
+                            const IntegerVector& receivers,
+                            const DataFrame& data,
+                            const NumericMatrix& compatibility_table,
+                            const CharacterVector& blood_types) {
+   if (!result.containsElementNamed("matching_donor")) {
+     stop("result must have a matching_donor element");
+   }
+   SEXP matching_donor = result["matching_donor"];
+   if (Rf_length(matching_donor) != donors.size()) {
+     stop("matching_donor must have one entry per donor");
    }
 
-   for (int i = 0; i < receivers.size(); i++) {
-     matching_receiver[std::to_string(receivers[i])] = NA_INTEGER;
+   // Format liste (un élément par donneur) ou vecteur aligné sur donors
+   IntegerVector partner(donors.size());
+   if (TYPEOF(matching_donor) == VECSXP) {
+     for (int i = 0; i < donors.size(); i++) {
+       SEXP v = VECTOR_ELT(matching_donor, i);
+       partner[i] = Rf_length(v) == 1 ? Rf_asInteger(v) : NA_INTEGER;
+     }
+   } else {
+     partner = as<IntegerVector>(matching_donor);
    }
 
+   SEXP blood_type_col = data["blood_type"];
+   BipartiteGraph csr;
+   build_class_graph(blood_types.size(), compatible_types(compatibility_table, blood_types),
+                     blood_classes(donors, blood_type_col, blood_types),
+                     blood_classes(receivers, blood_type_col, blood_types), csr);
+   std::vector<int> match_donor(csr.n_left, -1), match_receiver(csr.n_right, -1);
+   read_initial_matching(partner, "matching_donor", donors, receivers, csr, match_donor,
+                         match_receiver);
    int matching_size = 0;
-   int iteration = 0;
-
-   while (iteration < 1000) {
-     iteration++;
-     BFSResult bfs_result = bfs_hopcroft_karp_cpp(graph, donors, matching_donor, matching_receiver);
-
-     if (!bfs_result.found) {
-       break;
+   for (int v : match_donor) matching_size += v != -1;
+
+   std::vector<int> path;
+   bool maximum = !find_augmenting_path(csr, match_donor, match_receiver, path);
+   RObject augmenting_path;
+   if (!maximum) {
+     IntegerVector path_donor(path.size() / 2), path_receiver(path.size() / 2);
+     for (std::size_t k = 0; k < path.size() / 2; k++) {
+       path_donor[k] = donors[path[2 * k]];
+       path_receiver[k] = receivers[path[2 * k + 1]];
      }
+     augmenting_path = DataFrame::create(Named("donor") = path_donor,
+                                         Named("receiver") = path_receiver);
+   }
+   return List::create(
+     Named("maximum") = maximum,
+     Named("matching_size") = matching_size,
+     Named("augmenting_path") = augmenting_path
+   );
+ }
 
-     for (int i = 0; i < donors.size(); i++) {
-       int donor = donors[i];
-       std::string donor_key = std::to_string(donor);
-
-       if (matching_donor[donor_key] == NA_INTEGER) {
-         DFSResult dfs_result = dfs_hopcroft_karp_cpp(donor, graph, bfs_result.distance,
-                                                      matching_donor, matching_receiver);
-
-         if (dfs_result.success) {
-           matching_size++;
-           matching_donor = dfs_result.matching_donor;
-           matching_receiver = dfs_result.matching_receiver;
-         }
+//' Thread Scaling of the Hopcroft-Karp Engines
+ //'
+ //' Builds the CSR compatibility graph of one instance once, then times the
+ //' serial engine and the parallel engine for each thread count on it (best
+ //' of reps runs, graph building and R conversions excluded).
+ //'
+ //' @param donors Integer vector of donor IDs
+ //' @param receivers Integer vector of receiver IDs
+ //' @param data DataFrame containing blood type information
+ //' @param compatibility_table Numeric matrix of blood type compatibility
+ //' @param blood_types Character vector of blood type names
+ //' @param threads Integer vector of thread counts for the parallel engine
+ //' @param reps Number of timed runs per configuration
+ //' @return A data.frame with columns engine, threads, edges, matching_size
+ //'   and seconds
+ //' @export
+ // [[Rcpp::export]]
+ DataFrame hk_thread_scaling_cpp(const IntegerVector& donors,
+                                 const IntegerVector& receivers,
+                                 const DataFrame& data,
+                                 const NumericMatrix& compatibility_table,
+                                 const CharacterVector& blood_types,
+                                 IntegerVector threads = IntegerVector::create(1, 2, 4),
+                                 int reps = 3) {
+   SEXP blood_type_col = data["blood_type"];
+   BipartiteGraph csr;
+   build_class_graph(blood_types.size(), compatible_types(compatibility_table, blood_types),
+                     blood_classes(donors, blood_type_col, blood_types),
+                     blood_classes(receivers, blood_type_col, blood_types), csr);
+
+   int n_rows = threads.size() + 1;
+   CharacterVector engine(n_rows);
+   IntegerVector out_threads(n_rows), sizes(n_rows);
+   NumericVector seconds(n_rows);
+
+   // Ligne 0 : moteur série ; lignes suivantes : moteur parallèle
+   for (int row = 0; row < n_rows; row++) {
+     int n_threads = row == 0 ? 1 : threads[row - 1];
+     if (n_threads < 1) stop("threads must be at least 1");
+     WorkerPool pool(n_threads);
+     double best = -1;
+     int size = 0;
+     for (int r = 0; r < std::max(1, reps); r++) {
+       std::vector<int> match_donor(csr.n_left, -1), match_receiver(csr.n_right, -1);
+       auto start = std::chrono::steady_clock::now();
+       if (row == 0) {
+         HopcroftKarp serial;
+         size = serial.augment(csr, match_donor, match_receiver);
+       } else {
+         size = parallel_hopcroft_karp(csr, match_donor, match_receiver, pool);
        }
+       double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+       if (best < 0 || elapsed < best) best = elapsed;
      }
+     engine[row] = row == 0 ? "serial" : "parallel";
+     out_threads[row] = n_threads;
+     sizes[row] = size;
+     seconds[row] = best;
    }
 
-   List matching_donor_list;
-   List matching_receiver_list;
+   return DataFrame::create(
+     _["engine"] = engine,
+     _["threads"] = out_threads,
+     _["edges"] = (double)csr.adj.size(),
+     _["matching_size"] = sizes,
+     _["seconds"] = seconds,
+     _["stringsAsFactors"] = false
+   );
+ }
+
+//' Minimum-Cost Compatible Assignment
+ //'
+ //' Matches donors to compatible receivers at minimum total cost (transport
+ //' distance, unit expiry, urgency...) with an epsilon-scaling auction. The
+ //' graph is the one of build_compatibility_graph_cpp and costs are given
+ //' per edge, so the work follows the number of compatible pairs rather than
+ //' donors x receivers. Free bidders bid in parallel rounds against the same
+ //' prices, each receiver keeping the highest bid. Costs are shifted so
+ //' that the cheapest pair costs 0; with very large costs the final epsilon
+ //' is kept a few ulps above the largest price, and the tolerance reached
+ //' may be looser than the one requested (see the returned tolerance).
+ //'
+ //' @param graph Named list (donor id -> compatible receiver ids), as
+ //'   returned by build_compatibility_graph_cpp
+ //' @param costs Cost of each edge of graph: a list of numeric vectors
+ //'   aligned with graph, or one numeric vector with the edges of all donors
+ //'   in the order of graph
+ //' @param threads Number of bidding threads
+ //' @param unmatched_cost Cost of leaving a donor unmatched, a finite
+ //'   number. NULL (the default) gives a maximum matching of minimum cost; a
+ //'   finite penalty leaves a donor unmatched when all its pairs cost more
+ //' @param tolerance The total cost is within tolerance of the optimum
+ //'   (exact for integer costs with the default of 1)
+ //' @return A list with assignment (data.frame of donor, receiver and cost,
+ //'   NA for unmatched donors), matching_size, total_cost, tolerance (the
+ //'   bound actually guaranteed on the distance to the optimum, at least the
+ //'   one requested), scaling_passes and bids
+ //' @export
+ // [[Rcpp::export]]
+ List min_cost_assignment_cpp(const List& graph,
+                              SEXP costs,
+                              int threads = 1,
+                              Nullable<NumericVector> unmatched_cost = R_NilValue,
+                              double tolerance = 1) {
+   if (threads < 1) stop("threads must be at least 1");
+   if (!(tolerance > 0) || !std::isfinite(tolerance)) stop("tolerance must be positive");
+   double penalty = std::numeric_limits<double>::infinity();
+   if (unmatched_cost.isNotNull()) {
+     NumericVector value(unmatched_cost.get());
+     if (value.size() != 1 || !std::isfinite(value[0])) {
+       stop("unmatched_cost must be NULL or a single finite number");
+     }
+     penalty = value[0];
+   }
 
-   for (const auto& pair : matching_donor) {
-     matching_donor_list[pair.first] = pair.second;
+   // Graphe CSR : receveurs numérotés dans l'ordre de première apparition
+   int n_donors = graph.size();
+   BipartiteGraph csr;
+   csr.n_left = n_donors;
+   csr.start.assign(n_donors + 1, 0);
+   std::unordered_map<int, int> receiver_index;
+   std::vector<int> receiver_ids;
+   for (int i = 0; i < n_donors; i++) {
+     IntegerVector neighbours = graph[i];
+     for (int id : neighbours) {
+       if (id == NA_INTEGER) stop("graph contains NA receiver ids");
+       auto found = receiver_index.emplace(id, (int)receiver_ids.size());
+       if (found.second) receiver_ids.push_back(id);
+       csr.adj.push_back(found.first->second);
+     }
+     csr.start[i + 1] = csr.adj.size();
+   }
+   csr.n_right = receiver_ids.size();
+
+   // Coûts par arête, au même format que le graphe ou à plat
+   std::vector<double> cost;
+   cost.reserve(csr.adj.size());
+   if (TYPEOF(costs) == VECSXP) {
+     List cost_list(costs);
+     if (cost_list.size() != n_donors) stop("costs must have one element per donor of graph");
+     for (int i = 0; i < n_donors; i++) {
+       NumericVector row = cost_list[i];
+       if (row.size() != csr.start[i + 1] - csr.start[i]) {
+         stop("costs[[%d]] must have one value per receiver of graph[[%d]]", i + 1, i + 1);
+       }
+       cost.insert(cost.end(), row.begin(), row.end());
+     }
+   } else {
+     NumericVector flat(costs);
+     if ((std::size_t)flat.size() != csr.adj.size()) {
+       stop("costs must have one value per edge of graph (%d expected)", (int)csr.adj.size());
+     }
+     cost.assign(flat.begin(), flat.end());
+   }
+   for (double c : cost) {
+     if (!std::isfinite(c)) stop("costs must be finite");
    }
 
-   for (const auto& pair : matching_receiver) {
-     matching_receiver_list[pair.first] = pair.second;
+   WorkerPool pool(threads);
+   std::vector<int> match_donor;
+   std::vector<int64_t> match_edge;
+   AuctionStats stats;
+   double total_cost = auction_min_cost_matching(csr, cost, penalty, tolerance, pool,
+                                                 match_donor, match_edge, &stats);
+
+   // Une ligne par donneur, dans l'ordre du graphe
+   SEXP names = graph.names();
+   IntegerVector donor(n_donors), receiver(n_donors);
+   NumericVector pair_cost(n_donors);
+   int matching_size = 0;
+   for (int i = 0; i < n_donors; i++) {
+     donor[i] = Rf_isNull(names) ? i + 1 : std::atoi(CHAR(STRING_ELT(names, i)));
+     receiver[i] = NA_INTEGER;
+     pair_cost[i] = NA_REAL;
+     int j = match_donor[i];
+     if (j == -1) continue;
+     matching_size++;
+     receiver[i] = receiver_ids[j];
+     pair_cost[i] = cost[match_edge[i]];
    }
 
    return List::create(
-     Named("matching_donor") = matching_donor_list,
-     Named("matching_receiver") = matching_receiver_list,
+     Named("assignment") = DataFrame::create(
+       _["donor"] = donor,
+       _["receiver"] = receiver,
+       _["cost"] = pair_cost
+     ),
      Named("matching_size") = matching_size,
-     Named("graph") = graph
+     Named("total_cost") = total_cost,
+     Named("tolerance") = stats.tolerance,
+     Named("scaling_passes") = stats.scaling_passes,
+     Named("bids") = (double)stats.bids
    );
  }
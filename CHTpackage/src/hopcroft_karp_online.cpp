@@ -0,0 +1,159 @@
+#include <Rcpp.h>
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "blood_types.h"
+#include "online_matching_engine.h"
+using namespace Rcpp;
+
+// State behind the external pointer: the engine, the blood types it was
+// built for and the engine slot of every id in the market.
+struct OnlineMatcher {
+  OnlineMatcher(int n_types, const std::vector<char>& compatible) : engine(n_types, compatible) {}
+  OnlineClassMatcher engine;
+  std::unordered_map<std::string, int> type_index;
+  std::unordered_map<int, int> donor_slot, receiver_slot;
+  std::vector<int> donor_id, receiver_id;  // per engine slot
+};
+
+static OnlineMatcher& get_matcher(SEXP matcher) {
+  if (TYPEOF(matcher) != EXTPTRSXP || R_ExternalPtrAddr(matcher) == nullptr) {
+    stop("matcher is not a live online Hopcroft-Karp matcher");
+  }
+  return *static_cast<OnlineMatcher*>(R_ExternalPtrAddr(matcher));
+}
+
+static bool is_donor_side(const std::string& side) {
+  if (side == "donor") return true;
+  if (side == "receiver") return false;
+  stop("side must be \"donor\" or \"receiver\", not '%s'", side.c_str());
+}
+
+//' Online Hopcroft-Karp Matcher
+ //'
+ //' Creates a persistent maximum matcher for a market where donors and
+ //' receivers arrive and leave one at a time, returned as an external
+ //' pointer. Each arrival or departure runs a single augmenting-path search
+ //' from the affected agent and updates the stored matching in place, so
+ //' the matching is maximum after every event. The search works on the
+ //' blood types rather than on individual agents: an event costs
+ //' O(types^2) whatever the size of the market.
+ //'
+ //' @param compatibility_table Numeric matrix of blood type compatibility
+ //'   (1 for compatible, 0 for not), donors in rows
+ //' @param blood_types Character vector of blood type names
+ //' @return An external pointer to the matcher
+ //' @examples
+ //' table <- create_compatibility_table()
+ //' matcher <- hk_online_new(table, colnames(table))
+ //' hk_online_add(matcher, "donor", 1:2, c("O-", "A+"))
+ //' hk_online_add(matcher, "receiver", 3L, "A+")
+ //' hk_online_matching(matcher)
+ //' @export
+ // [[Rcpp::export]]
+ SEXP hk_online_new(const NumericMatrix& compatibility_table, const CharacterVector& blood_types) {
+   int n_types = blood_types.size();
+   std::vector<char> compatible = compatible_types(compatibility_table, blood_types);
+
+   XPtr<OnlineMatcher> matcher(new OnlineMatcher(n_types, compatible), true);
+   for (int k = 0; k < n_types; k++) {
+     matcher->type_index.emplace(std::string(CHAR(STRING_ELT(blood_types, k))), k);
+   }
+   return matcher;
+ }
+
+//' Add Donors or Receivers to an Online Matcher
+ //'
+ //' Agents are added in order, each one as a separate event. An unknown or
+ //' NA blood type is accepted and never matched.
+ //'
+ //' @param matcher A matcher created by hk_online_new()
+ //' @param side "donor" or "receiver"
+ //' @param ids Integer vector of new ids (not already in the market on that
+ //'   side)
+ //' @param blood_type Character vector of their blood types, same length as
+ //'   ids
+ //' @return The size of the maximum matching after the last arrival
+ //' @export
+ // [[Rcpp::export]]
+ int hk_online_add(SEXP matcher, std::string side, const IntegerVector& ids,
+                   const CharacterVector& blood_type) {
+   OnlineMatcher& m = get_matcher(matcher);
+   bool donor = is_donor_side(side);
+   if (blood_type.size() != ids.size()) stop("blood_type must have one value per id");
+   auto& slot_of = donor ? m.donor_slot : m.receiver_slot;
+   auto& id_of = donor ? m.donor_id : m.receiver_id;
+
+   for (int i = 0; i < ids.size(); i++) {
+     int id = ids[i];
+     if (id == NA_INTEGER) stop("ids must not be NA");
+     if (slot_of.count(id)) stop("%s %d is already in the market", side.c_str(), id);
+     int cls = -1;
+     SEXP type = STRING_ELT(blood_type, i);
+     if (type != NA_STRING) {
+       auto it = m.type_index.find(std::string(CHAR(type)));
+       if (it != m.type_index.end()) cls = it->second;
+     }
+     int slot = donor ? m.engine.add_donor(cls) : m.engine.add_recipient(cls);
+     if (slot >= (int)id_of.size()) id_of.resize(slot + 1);
+     id_of[slot] = id;
+     slot_of.emplace(id, slot);
+   }
+   return m.engine.size();
+ }
+
+//' Remove Donors or Receivers from an Online Matcher
+ //'
+ //' @param matcher A matcher created by hk_online_new()
+ //' @param side "donor" or "receiver"
+ //' @param ids Integer vector of ids leaving the market, in order
+ //' @return The size of the maximum matching after the last departure
+ //' @export
+ // [[Rcpp::export]]
+ int hk_online_remove(SEXP matcher, std::string side, const IntegerVector& ids) {
+   OnlineMatcher& m = get_matcher(matcher);
+   bool donor = is_donor_side(side);
+   auto& slot_of = donor ? m.donor_slot : m.receiver_slot;
+
+   for (int i = 0; i < ids.size(); i++) {
+     auto it = slot_of.find(ids[i]);
+     if (it == slot_of.end()) stop("unknown %s id %d", side.c_str(), ids[i]);
+     if (donor) {
+       m.engine.remove_donor(it->second);
+     } else {
+       m.engine.remove_recipient(it->second);
+     }
+     slot_of.erase(it);
+   }
+   return m.engine.size();
+ }
+
+//' Current Matching of an Online Matcher
+ //'
+ //' @param matcher A matcher created by hk_online_new()
+ //' @return A data.frame with one row per donor in the market, by
+ //'   increasing id (columns: donor, receiver); receiver is NA for an
+ //'   unmatched donor
+ //' @export
+ // [[Rcpp::export]]
+ DataFrame hk_online_matching(SEXP matcher) {
+   OnlineMatcher& m = get_matcher(matcher);
+   std::vector<std::pair<int, int>> rows;  // (donor id, engine slot)
+   rows.reserve(m.donor_slot.size());
+   for (const auto& entry : m.donor_slot) rows.push_back(entry);
+   std::sort(rows.begin(), rows.end());
+
+   int n = rows.size();
+   IntegerVector donor(n), receiver(n);
+   for (int i = 0; i < n; i++) {
+     donor[i] = rows[i].first;
+     int r = m.engine.partner_of_donor(rows[i].second);
+     receiver[i] = r == -1 ? NA_INTEGER : m.receiver_id[r];
+   }
+   return DataFrame::create(
+     _["donor"] = donor,
+     _["receiver"] = receiver
+   );
+ }
@@ -0,0 +1,171 @@
+#include <Rcpp.h>
+#include <string>
+#include <vector>
+#include "instance_generator.h"
+using namespace Rcpp;
+
+// Converts one side (n lists of `length` 0-based ids) to the requested R shape
+static SEXP preference_output(const std::vector<int>& lists, int n, int length,
+                              const std::string& output, const CharacterVector& own_names,
+                              const CharacterVector& other_names) {
+  if (output == "matrix") {
+    IntegerMatrix m(length, n);
+    for (std::size_t i = 0; i < lists.size(); i++) m[i] = lists[i] + 1;
+    return m;
+  }
+  List result(n);
+  for (int a = 0; a < n; a++) {
+    const int* ids = lists.data() + (std::size_t)a * length;
+    if (output == "list") {
+      IntegerVector v(length);
+      for (int k = 0; k < length; k++) v[k] = ids[k] + 1;
+      result[a] = v;
+    } else {
+      // Names are shared: every list points to the same CHARSXPs
+      CharacterVector v(length);
+      for (int k = 0; k < length; k++) SET_STRING_ELT(v, k, STRING_ELT(other_names, ids[k]));
+      result[a] = v;
+    }
+  }
+  if (output == "names") result.names() = own_names;
+  return result;
+}
+
+static CharacterVector agent_names(const char* prefix, int n) {
+  CharacterVector names(n);
+  for (int a = 0; a < n; a++) names[a] = prefix + std::to_string(a + 1);
+  return names;
+}
+
+//' Generate Random Stable Marriage Instances
+ //'
+ //' Draws the men's and the women's preference lists in C++, on several
+ //' threads. Every agent has its own random stream derived from the seed, so
+ //' the instance depends on the seed only, not on the number of threads, and
+ //' does not use R's random number generator.
+ //'
+ //' Families:
+ //' "uniform" draws independent uniform permutations (uniform subsets in
+ //' random order when lists are truncated). "correlated" gives every agent a
+ //' shared quality q (uniform, one draw per agent of the other side) and ranks
+ //' j by correlation * q[j] + (1 - correlation) * u, with u uniform per list
+ //' entry. "master" is correlated with correlation = 1: every agent of a side
+ //' has the same list, the worst case of Gale-Shapley.
+ //'
+ //' @param n Number of men/women
+ //' @param family "uniform", "correlated" or "master"
+ //' @param list_length Length of every list; a negative value (default)
+ //'   gives complete lists of n ids. Truncated lists keep the best ids of the
+ //'   family's order
+ //' @param correlation Weight of the shared quality, in [0, 1]
+ //'   ("correlated" only)
+ //' @param seed Seed of the generator
+ //' @param threads Number of worker threads
+ //' @param output "matrix": list_length x n integer matrices of 1-based ids,
+ //'   one agent per column, as read by best_gs_bucket_matrix_cpp();
+ //'   "list": lists of n integer vectors of 1-based ids, as read by
+ //'   gs_pref_file_write_cpp(); "names": named lists of names "M1".., "W1"..,
+ //'   as read by gale_shapley_cpp() and best_gs_bucket_cpp()
+ //' @return A list with elements men and women
+ //' @export
+ // [[Rcpp::export]]
+ List generate_preferences_cpp(int n, std::string family = "uniform", int list_length = -1,
+                               double correlation = 0.5, int seed = 42, int threads = 1,
+                               std::string output = "matrix") {
+   if (n < 0) stop("n must be non-negative");
+   if (list_length < 0) list_length = n;
+   if (list_length > n) stop("list_length must be at most n (%d)", n);
+   if (output != "matrix" && output != "list" && output != "names") {
+     stop("output must be \"matrix\", \"list\" or \"names\", not '%s'", output.c_str());
+   }
+
+   PreferenceFamily kind = PreferenceFamily::uniform;
+   if (family == "correlated" || family == "master") {
+     kind = PreferenceFamily::correlated;
+     if (family == "master") correlation = 1;
+     if (!(correlation >= 0 && correlation <= 1)) stop("correlation must be in [0, 1]");
+   } else if (family != "uniform") {
+     stop("family must be \"uniform\", \"correlated\" or \"master\", not '%s'", family.c_str());
+   }
+
+   std::vector<int> men((std::size_t)n * list_length), women(men.size());
+   {
+     WorkerPool pool(threads);
+     generate_preference_lists(n, list_length, kind, correlation, (uint64_t)(unsigned)seed, 0,
+                               pool, men.data());
+     generate_preference_lists(n, list_length, kind, correlation, (uint64_t)(unsigned)seed, 1,
+                               pool, women.data());
+   }
+
+   CharacterVector men_names, women_names;
+   if (output == "names") {
+     men_names = agent_names("M", n);
+     women_names = agent_names("W", n);
+   }
+   return List::create(
+     _["men"] = preference_output(men, n, list_length, output, men_names, women_names),
+     _["women"] = preference_output(women, n, list_length, output, women_names, men_names)
+   );
+ }
+
+//' Generate a Random Donor/Receiver Population
+ //'
+ //' Draws the blood types of n_donors donors and n_receivers receivers in
+ //' C++, on several threads, in the shape used by hopcroft_karp() and
+ //' hopcroft_karp_cpp(). As with generate_preferences_cpp(), every
+ //' individual has its own random stream, so the population depends on the
+ //' seed only.
+ //'
+ //' @param n_donors Number of donors
+ //' @param n_receivers Number of receivers
+ //' @param frequencies Named vector of type frequencies (any non-negative
+ //'   weights, names are the types). By default, the ABO/Rh frequencies of
+ //'   the US population in the order of create_compatibility_table()
+ //' @param seed Seed of the generator
+ //' @param threads Number of worker threads
+ //' @return A list with data (data.frame with columns id and blood_type),
+ //'   donors (ids 1..n_donors) and receivers (the following ids)
+ //' @export
+ // [[Rcpp::export]]
+ List generate_blood_population_cpp(int n_donors, int n_receivers,
+                                    Nullable<NumericVector> frequencies = R_NilValue,
+                                    int seed = 42, int threads = 1) {
+   if (n_donors < 0 || n_receivers < 0) stop("n_donors and n_receivers must be non-negative");
+   NumericVector freq;
+   if (frequencies.isNotNull()) {
+     freq = frequencies.get();
+   } else {
+     freq = NumericVector::create(
+       _["A+"] = 0.34, _["A-"] = 0.06, _["B+"] = 0.10, _["B-"] = 0.02,
+       _["AB+"] = 0.04, _["AB-"] = 0.01, _["O+"] = 0.38, _["O-"] = 0.05
+     );
+   }
+   if (freq.size() == 0 || Rf_getAttrib(freq, R_NamesSymbol) == R_NilValue) {
+     stop("frequencies must be a named vector");
+   }
+   CharacterVector types = freq.names();
+   std::vector<double> weights(freq.begin(), freq.end());
+   double total = 0;
+   for (double w : weights) {
+     if (!(w >= 0)) stop("frequencies must be non-negative");
+     total += w;
+   }
+   if (!(total > 0)) stop("frequencies must not all be zero");
+
+   int n = n_donors + n_receivers;
+   std::vector<int> drawn(n);
+   {
+     WorkerPool pool(threads);
+     generate_types(n, weights, (uint64_t)(unsigned)seed, pool, drawn.data());
+   }
+
+   CharacterVector blood_type(n);
+   for (int i = 0; i < n; i++) SET_STRING_ELT(blood_type, i, STRING_ELT(types, drawn[i]));
+   IntegerVector ids = seq_len(n);
+   return List::create(
+     _["data"] = DataFrame::create(_["id"] = ids, _["blood_type"] = blood_type,
+                                   _["stringsAsFactors"] = false),
+     _["donors"] = IntegerVector(ids.begin(), ids.begin() + n_donors),
+     _["receivers"] = IntegerVector(ids.begin() + n_donors, ids.end())
+   );
+ }
@@ -0,0 +1,149 @@
+// Seeded random instances for benchmarks and simulations.
+//
+// Every agent draws from its own SplitMix64 stream, keyed by the seed, the
+// side and the agent's index. The instance is therefore a function of the
+// seed alone: agents can be generated in any order, on any number of
+// threads, and the result does not change.
+//
+// Preference families:
+//   uniform     independent uniform permutations (or uniform k-subsets in
+//               random order for truncated lists): O(n) per complete list,
+//               O(k) per truncated one
+//   correlated  agent a ranks j by  c * quality[j] + (1 - c) * noise[a][j],
+//               where quality is shared by the side and noise is
+//               uniform; c = 1 gives one master list (the worst case of
+//               Gale-Shapley), c = 0 independent lists. O(n log k) per list
+#ifndef CHT_INSTANCE_GENERATOR_H
+#define CHT_INSTANCE_GENERATOR_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "worker_pool.h"
+
+class SplitMix64 {
+public:
+  explicit SplitMix64(uint64_t state) : state_(state) {}
+
+  // Independent stream number `stream` of the generator seeded with seed
+  static SplitMix64 stream(uint64_t seed, uint64_t stream) {
+    SplitMix64 mixer(seed);
+    uint64_t base = mixer.next();
+    return SplitMix64(base ^ SplitMix64(stream * 0x9e3779b97f4a7c15ULL + base).next());
+  }
+
+  uint64_t next() {
+    uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  // Uniform in [0, 1)
+  double uniform() { return (next() >> 11) * 0x1.0p-53; }
+
+  // Uniform in [0, bound), without modulo bias (Lemire)
+  uint32_t below(uint32_t bound) {
+    uint64_t m = (uint64_t)(uint32_t)next() * bound;
+    if ((uint32_t)m < bound) {
+      uint32_t threshold = (uint32_t)(-bound) % bound;
+      while ((uint32_t)m < threshold) m = (uint64_t)(uint32_t)next() * bound;
+    }
+    return (uint32_t)(m >> 32);
+  }
+
+private:
+  uint64_t state_;
+};
+
+enum class PreferenceFamily { uniform, correlated };
+
+// Stream numbers: agent a of side s uses s * stream_stride + a, and the
+// shared qualities of side s the last stream of its range (never an agent)
+static const uint64_t stream_stride = uint64_t(1) << 40;
+
+// Fills lists (n agents x length ids, agent after agent, 0-based ids) with
+// the preferences of one side (0 = men, 1 = women).
+inline void generate_preference_lists(int n, int length, PreferenceFamily family, double correlation,
+                                      uint64_t seed, int side, WorkerPool& pool, int* lists) {
+  const uint64_t first_stream = (uint64_t)side * stream_stride;
+  std::vector<double> quality;
+  if (family == PreferenceFamily::correlated) {
+    SplitMix64 rng = SplitMix64::stream(seed, first_stream + stream_stride - 1);
+    quality.resize(n);
+    for (double& q : quality) q = correlation * rng.uniform();
+  }
+
+  // Without noise every agent has the same list: sort it once
+  std::vector<int> master;
+  if (family == PreferenceFamily::correlated && correlation >= 1) {
+    master.resize(n);
+    for (int j = 0; j < n; j++) master[j] = j;
+    std::stable_sort(master.begin(), master.end(),
+                     [&](int x, int y) { return quality[x] > quality[y]; });
+  }
+
+  // Per thread: stamps for subset sampling, scores for sorting
+  std::vector<std::vector<int>> stamp(pool.size());
+  std::vector<std::vector<std::pair<double, int>>> scored(pool.size());
+  pool.parallel_for(n, [&](std::size_t begin, std::size_t end, int t) {
+    for (std::size_t a = begin; a < end; a++) {
+      SplitMix64 rng = SplitMix64::stream(seed, first_stream + a);
+      int* out = lists + a * (std::size_t)length;
+
+      if (!master.empty()) {
+        std::copy(master.begin(), master.begin() + length, out);
+      } else if (family == PreferenceFamily::correlated) {
+        std::vector<std::pair<double, int>>& s = scored[t];
+        s.resize(n);
+        for (int j = 0; j < n; j++) s[j] = {-(quality[j] + (1 - correlation) * rng.uniform()), j};
+        if (length < n) std::nth_element(s.begin(), s.begin() + length, s.end());
+        std::sort(s.begin(), s.begin() + length);
+        for (int k = 0; k < length; k++) out[k] = s[k].second;
+      } else if (2 * (std::size_t)length >= (std::size_t)n) {
+        // Fisher-Yates, stopped after length draws
+        std::vector<int>& perm = stamp[t];
+        perm.resize(n);
+        for (int j = 0; j < n; j++) perm[j] = j;
+        for (int k = 0; k < length; k++) {
+          int r = k + (int)rng.below((uint32_t)(n - k));
+          std::swap(perm[k], perm[r]);
+          out[k] = perm[k];
+        }
+      } else {
+        // Floyd's subset sampling, then a shuffle of the subset. The stamp
+        // of an id is the last agent of this thread that took it.
+        std::vector<int>& seen = stamp[t];
+        if (seen.empty()) seen.assign(n, -1);
+        for (int j = n - length, k = 0; j < n; j++, k++) {
+          int r = (int)rng.below((uint32_t)j + 1);
+          int pick = seen[r] == (int)a ? j : r;
+          seen[pick] = (int)a;
+          out[k] = pick;
+        }
+        for (int k = length - 1; k > 0; k--) std::swap(out[k], out[rng.below((uint32_t)k + 1)]);
+      }
+    }
+  });
+}
+
+// Draws one type per individual from the given frequencies (any positive
+// weights); individual i uses stream i.
+inline void generate_types(int n, const std::vector<double>& frequencies, uint64_t seed,
+                           WorkerPool& pool, int* types) {
+  std::vector<double> cumulative(frequencies.size());
+  double total = 0;
+  for (std::size_t k = 0; k < frequencies.size(); k++) cumulative[k] = total += frequencies[k];
+  const int last = (int)frequencies.size() - 1;
+  pool.parallel_for(n, [&](std::size_t begin, std::size_t end, int) {
+    for (std::size_t i = begin; i < end; i++) {
+      double u = SplitMix64::stream(seed, i).uniform() * total;
+      int k = (int)(std::upper_bound(cumulative.begin(), cumulative.end(), u) - cumulative.begin());
+      types[i] = std::min(k, last);
+    }
+  });
+}
+
+#endif
@@ -0,0 +1,107 @@
+#include <Rcpp.h>
+#include <cstddef>
+#include <vector>
+#include "blood_types.h"
+#include "kidney_exchange_engine.h"
+using namespace Rcpp;
+
+//' Kidney Paired Exchange
+ //'
+ //' Finds exchange cycles among incompatible donor/patient pairs: in a cycle
+ //' of pairs p1, p2, ..., pk, the donor of p1 gives to the patient of p2,
+ //' ..., the donor of pk to the patient of p1, and all k transplants take
+ //' place. The number of transplants is maximised over cycles of at most
+ //' max_length pairs.
+ //'
+ //' Blood type compatibility only depends on the (donor type, patient type)
+ //' class of a pair, so the search runs on classes (at most 64 with eight
+ //' types) rather than pairs: cycles of classes are enumerated on several
+ //' threads, then an integer program chooses how many copies of each cycle
+ //' to run, solved by branch-and-bound. The cost hardly depends on the
+ //' number of pairs.
+ //'
+ //' @param donors Donor ids, one per pair
+ //' @param patients Patient ids, aligned with donors
+ //' @param data Data.frame with columns id and blood_type
+ //' @param compatibility_table Compatibility matrix (donor type x patient type)
+ //' @param blood_types Blood types in the order of compatibility_table
+ //' @param max_length Maximum number of pairs in a cycle (at least 2)
+ //' @param threads Number of threads enumerating the class cycles
+ //' @param node_limit Maximum number of branch-and-bound nodes; the best
+ //'   packing found so far is returned past it
+ //' @param max_cycles Maximum number of class cycles, an error is raised
+ //'   above it
+ //' @return A list with cycles (data.frame of cycle, donor and patient, the
+ //'   donor of each row giving to the patient of the next row of the same
+ //'   cycle, the last to the first), transplants, bound (upper bound on the
+ //'   transplants from the linear relaxation), optimal (TRUE when proven),
+ //'   nodes and class_cycles
+ //' @export
+ // [[Rcpp::export]]
+ List kidney_exchange_cpp(const IntegerVector& donors,
+                          const IntegerVector& patients,
+                          const DataFrame& data,
+                          const NumericMatrix& compatibility_table,
+                          const CharacterVector& blood_types,
+                          int max_length = 3,
+                          int threads = 1,
+                          int node_limit = 10000,
+                          int max_cycles = 100000) {
+   if (donors.size() != patients.size()) stop("donors and patients must have the same length");
+   if (max_length < 2) stop("max_length must be at least 2");
+   if (threads < 1) stop("threads must be at least 1");
+   if (node_limit < 1) stop("node_limit must be at least 1");
+
+   SEXP blood_type_col = data["blood_type"];
+   int n_types = blood_types.size();
+   std::vector<char> compatible = compatible_types(compatibility_table, blood_types);
+   std::vector<int> donor_type = blood_classes(donors, blood_type_col, blood_types);
+   std::vector<int> patient_type = blood_classes(patients, blood_type_col, blood_types);
+
+   // Class of a pair: donor type x patient type (-1 if either is unknown)
+   int n_pairs = donors.size(), n_classes = n_types * n_types;
+   std::vector<int> pair_class(n_pairs, -1), count(n_classes, 0);
+   for (int i = 0; i < n_pairs; i++) {
+     if (donor_type[i] == -1 || patient_type[i] == -1) continue;
+     pair_class[i] = donor_type[i] * n_types + patient_type[i];
+     count[pair_class[i]]++;
+   }
+   // Class a -> class b when the donor of a can give to the patient of b
+   std::vector<char> class_compatible((std::size_t)n_classes * n_classes);
+   for (int a = 0; a < n_classes; a++) {
+     for (int b = 0; b < n_classes; b++) {
+       class_compatible[(std::size_t)a * n_classes + b] =
+         compatible[(std::size_t)(a / n_types) * n_types + b % n_types];
+     }
+   }
+
+   CycleSet class_cycles, pair_cycles;
+   {
+     WorkerPool pool(threads);
+     enumerate_class_cycles(n_classes, class_compatible, count, max_length, max_cycles, pool,
+                            class_cycles);
+   }
+   PackingResult packing = pack_class_cycles(class_cycles, count, node_limit);
+   realize_class_cycles(class_cycles, packing.copies, n_classes, pair_class, pair_cycles);
+
+   // One row per pair taking part, cycle after cycle
+   int n_rows = pair_cycles.members.size();
+   IntegerVector cycle(n_rows), donor(n_rows), patient(n_rows);
+   for (int c = 0; c < pair_cycles.size(); c++) {
+     for (int k = pair_cycles.start[c]; k < pair_cycles.start[c + 1]; k++) {
+       int p = pair_cycles.members[k];
+       cycle[k] = c + 1;
+       donor[k] = donors[p];
+       patient[k] = patients[p];
+     }
+   }
+
+   return List::create(
+     _["cycles"] = DataFrame::create(_["cycle"] = cycle, _["donor"] = donor, _["patient"] = patient),
+     _["transplants"] = (double)packing.transplants,
+     _["bound"] = (double)packing.bound,
+     _["optimal"] = packing.optimal,
+     _["nodes"] = (double)packing.nodes,
+     _["class_cycles"] = class_cycles.size()
+   );
+ }
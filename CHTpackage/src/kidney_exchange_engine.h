@@ -0,0 +1,507 @@
+// Kidney paired exchange: maximum cycle packing on pair classes.
+//
+// Each pair brings a donor and a patient who cannot receive from each
+// other; the donor of pair u can give to the patient of pair v when the
+// table says their blood types are compatible. Compatibility only depends
+// on the (donor type, patient type) class of the pairs, so pairs of one
+// class are interchangeable and the exchange is solved on classes:
+//  1. enumerate_class_cycles() lists every cycle of 2..max_length classes.
+//     A class may appear several times in a cycle if its donors can give to
+//     its own patients and it has enough pairs. Each cycle is listed once,
+//     from its smallest class s; the search from s only steps to classes
+//     >= s that can still get back to s in the length left. Start classes
+//     are shared between threads.
+//  2. pack_class_cycles() chooses how many copies of each cycle to run: the
+//     integer program, with one row per class,
+//        max  sum_c length(c) x_c
+//        s.t. sum_c mult(k, c) x_c <= count(k)   for every class k
+//             x_c integer >= 0
+//     solved exactly by depth-first branch-and-bound on a bounded primal
+//     simplex. Its size depends on the number of classes, not of pairs, so
+//     pools of any size solve in about the same time.
+//  3. realize_class_cycles() hands out concrete pairs, class by class in
+//     input order: O(pairs).
+#ifndef CHT_KIDNEY_EXCHANGE_ENGINE_H
+#define CHT_KIDNEY_EXCHANGE_ENGINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "worker_pool.h"
+
+// Cycles as runs of one flat array: cycle c is members[start[c] .. start[c+1])
+struct CycleSet {
+  std::vector<int> start{0};
+  std::vector<int> members;
+
+  int size() const { return (int)start.size() - 1; }
+  int length(int c) const { return start[c + 1] - start[c]; }
+  void add(const int* first, int length) {
+    members.insert(members.end(), first, first + length);
+    start.push_back((int)members.size());
+  }
+};
+
+// Cycles of the class graph with 2..max_length entries (compatible is
+// n_classes x n_classes, row-major (donor class, patient class)); a class
+// is used at most count[k] times per cycle. Throws if there are more than
+// max_cycles cycles.
+inline void enumerate_class_cycles(int n_classes, const std::vector<char>& compatible,
+                                   const std::vector<int>& count, int max_length,
+                                   long long max_cycles, WorkerPool& pool, CycleSet& cycles) {
+  const int K = n_classes;
+  auto edge = [&](int a, int b) { return compatible[(std::size_t)a * K + b] != 0; };
+
+  std::vector<CycleSet> found(K);
+  std::atomic<int> next_start(0);
+  std::atomic<long long> total(0);
+  std::atomic<bool> too_many(false);
+  pool.run([&](int) {
+    std::vector<int> dist(K), queue, path, used(K, 0), first_choice;
+    for (int s = next_start++; s < K && !too_many; s = next_start++) {
+      if (count[s] == 0) continue;
+      // dist[v] = edges from v back to s through classes >= s, up to
+      // max_length (unreached: max_length + 1)
+      std::fill(dist.begin(), dist.end(), max_length + 1);
+      dist[s] = 0;
+      queue.assign(1, s);
+      for (std::size_t head = 0; head < queue.size(); head++) {
+        int w = queue[head];
+        if (dist[w] == max_length) break;
+        for (int v = s + 1; v < K; v++) {
+          if (count[v] > 0 && dist[v] > max_length && edge(v, w)) {
+            dist[v] = dist[w] + 1;
+            queue.push_back(v);
+          }
+        }
+      }
+
+      CycleSet& out = found[s];
+      // Iterative DFS; first_choice[d] is the next class tried at depth d
+      path.assign(1, s);
+      used[s] = 1;
+      first_choice.assign(1, s);
+      while (!path.empty()) {
+        int depth = (int)path.size();
+        int last = path.back();
+        int v = first_choice.back();
+        // Closing edge, checked once when the path is first reached
+        if (v == s && depth >= 2 && edge(last, s)) {
+          // Smallest rotation only: matters when s itself repeats
+          bool canonical = true;
+          for (int r = 1; r < depth && canonical; r++) {
+            if (path[r] != s) continue;
+            for (int k = 0; k < depth; k++) {
+              int a = path[(r + k) % depth], b = path[k];
+              if (a != b) {
+                canonical = a > b;
+                break;
+              }
+            }
+          }
+          if (canonical) {
+            out.add(path.data(), depth);
+            if (++total > max_cycles) too_many = true;
+          }
+        }
+        // Next extension of the path
+        while (v < K && !(depth < max_length && count[v] > used[v] && edge(last, v) &&
+                          dist[v] <= max_length - depth)) {
+          v++;
+        }
+        if (v < K && !too_many) {
+          first_choice.back() = v + 1;
+          path.push_back(v);
+          used[v]++;
+          first_choice.push_back(s);
+        } else {
+          used[last]--;
+          path.pop_back();
+          first_choice.pop_back();
+        }
+      }
+    }
+  });
+  if (too_many) {
+    throw std::runtime_error("more than " + std::to_string(max_cycles) +
+                             " class cycles: lower max_length");
+  }
+
+  cycles = CycleSet();
+  for (int s = 0; s < K; s++) {
+    for (int c = 0; c < found[s].size(); c++) {
+      cycles.add(found[s].members.data() + found[s].start[c], found[s].length(c));
+    }
+  }
+}
+
+// Primal simplex for  max c.x  s.t.  A x <= b,  0 <= x <= upper,  with
+// A >= 0 and b >= 0 so that the slack basis is feasible. Columns are sparse
+// (the classes of a cycle); the basis inverse is dense, m x m, and is
+// rebuilt from scratch every refactor_every pivots.
+class BoundedSimplex {
+public:
+  struct Entry {
+    int row;
+    double value;
+  };
+
+  BoundedSimplex(int m, const std::vector<std::vector<Entry>>& columns, const std::vector<double>& cost)
+      : m_(m), n_((int)columns.size()), columns_(columns), cost_(cost) {}
+
+  // Solves for the given bounds; x receives the structural values. Returns
+  // the objective, or -infinity if b has a negative entry.
+  double solve(const std::vector<double>& b, const std::vector<double>& upper, std::vector<double>& x) {
+    for (double v : b) {
+      if (v < -eps) return -std::numeric_limits<double>::infinity();
+    }
+    upper_ = upper;
+    b_ = b;
+    basis_.resize(m_);
+    at_upper_.assign(n_ + m_, 0);
+    position_.assign(n_ + m_, -1);
+    for (int i = 0; i < m_; i++) {
+      basis_[i] = n_ + i;
+      position_[n_ + i] = i;
+    }
+    refactor();
+
+    std::vector<double> y(m_), alpha(m_);
+    int degenerate = 0;
+    for (long long iteration = 0;; iteration++) {
+      if (iteration > 0 && iteration % refactor_every == 0) refactor();
+      for (int i = 0; i < m_; i++) {
+        double sum = 0;
+        for (int k = 0; k < m_; k++) sum += basic_cost(k) * inverse_[(std::size_t)k * m_ + i];
+        y[i] = sum;
+      }
+
+      // Pricing: Dantzig's rule, Bland's after a run of degenerate pivots
+      bool bland = degenerate > 50;
+      int entering = -1;
+      double best = eps;
+      for (int j = 0; j < n_ + m_; j++) {
+        if (position_[j] != -1) continue;
+        double d = j < n_ ? cost_[j] : 0;
+        if (j < n_) {
+          for (const Entry& e : columns_[j]) d -= e.value * y[e.row];
+        } else {
+          d = -y[j - n_];
+        }
+        double gain = at_upper_[j] ? -d : d;
+        if (gain > best && (at_upper_[j] || bound(j) > eps)) {
+          entering = j;
+          best = gain;
+          if (bland) break;
+        }
+      }
+      if (entering == -1) break;
+
+      // alpha = B^-1 a_entering; basic values move by -direction * alpha * t
+      double direction = at_upper_[entering] ? -1 : 1;
+      for (int i = 0; i < m_; i++) alpha[i] = 0;
+      if (entering < n_) {
+        for (const Entry& e : columns_[entering]) {
+          for (int i = 0; i < m_; i++) alpha[i] += inverse_[(std::size_t)i * m_ + e.row] * e.value;
+        }
+      } else {
+        for (int i = 0; i < m_; i++) alpha[i] = inverse_[(std::size_t)i * m_ + entering - n_];
+      }
+      double step = bound(entering);
+      int leaving = -1;
+      bool leaves_at_upper = false;
+      for (int i = 0; i < m_; i++) {
+        double rate = -direction * alpha[i];
+        double limit;
+        bool to_upper;
+        if (rate < -eps) {
+          limit = value_[i] / -rate;
+          to_upper = false;
+        } else if (rate > eps && std::isfinite(bound(basis_[i]))) {
+          limit = (bound(basis_[i]) - value_[i]) / rate;
+          to_upper = true;
+        } else {
+          continue;
+        }
+        if (limit < step - eps || (limit < step + eps && leaving != -1 && basis_[i] < basis_[leaving])) {
+          step = std::max(0.0, limit);
+          leaving = i;
+          leaves_at_upper = to_upper;
+        }
+      }
+      degenerate = step > eps ? 0 : degenerate + 1;
+
+      for (int i = 0; i < m_; i++) value_[i] -= direction * alpha[i] * step;
+      if (leaving == -1) {
+        // Bound flip: the entering variable crosses its whole range
+        at_upper_[entering] = !at_upper_[entering];
+        continue;
+      }
+      double entering_value = (at_upper_[entering] ? bound(entering) : 0) + direction * step;
+      int out = basis_[leaving];
+      position_[out] = -1;
+      at_upper_[out] = leaves_at_upper;
+      basis_[leaving] = entering;
+      position_[entering] = leaving;
+      at_upper_[entering] = 0;
+      value_[leaving] = entering_value;
+      pivot(leaving, alpha);
+    }
+
+    x.assign(n_, 0);
+    double objective = 0;
+    for (int j = 0; j < n_; j++) {
+      if (position_[j] != -1) {
+        x[j] = value_[position_[j]];
+      } else if (at_upper_[j]) {
+        x[j] = upper_[j];
+      }
+      objective += cost_[j] * x[j];
+    }
+    return objective;
+  }
+
+  static constexpr double eps = 1e-9;
+
+private:
+  static constexpr int refactor_every = 100;
+
+  double bound(int j) const { return j < n_ ? upper_[j] : std::numeric_limits<double>::infinity(); }
+  double basic_cost(int i) const { return basis_[i] < n_ ? cost_[basis_[i]] : 0; }
+
+  // Row operations that turn column alpha into the unit vector of row r
+  void pivot(int r, const std::vector<double>& alpha) {
+    double* row_r = &inverse_[(std::size_t)r * m_];
+    double scale = 1 / alpha[r];
+    for (int k = 0; k < m_; k++) row_r[k] *= scale;
+    for (int i = 0; i < m_; i++) {
+      if (i == r || alpha[i] == 0) continue;
+      double* row_i = &inverse_[(std::size_t)i * m_];
+      double factor = alpha[i];
+      for (int k = 0; k < m_; k++) row_i[k] -= factor * row_r[k];
+    }
+  }
+
+  // Inverts the basis matrix (Gauss-Jordan, partial pivoting) and recomputes
+  // the basic values from the nonbasic ones
+  void refactor() {
+    std::vector<double> a((std::size_t)m_ * m_, 0);
+    for (int i = 0; i < m_; i++) {
+      int j = basis_[i];
+      if (j < n_) {
+        for (const Entry& e : columns_[j]) a[(std::size_t)e.row * m_ + i] = e.value;
+      } else {
+        a[(std::size_t)(j - n_) * m_ + i] = 1;
+      }
+    }
+    inverse_.assign((std::size_t)m_ * m_, 0);
+    for (int i = 0; i < m_; i++) inverse_[(std::size_t)i * m_ + i] = 1;
+    for (int col = 0; col < m_; col++) {
+      int p = col;
+      for (int i = col + 1; i < m_; i++) {
+        if (std::fabs(a[(std::size_t)i * m_ + col]) > std::fabs(a[(std::size_t)p * m_ + col])) p = i;
+      }
+      if (p != col) {
+        for (int k = 0; k < m_; k++) {
+          std::swap(a[(std::size_t)p * m_ + k], a[(std::size_t)col * m_ + k]);
+          std::swap(inverse_[(std::size_t)p * m_ + k], inverse_[(std::size_t)col * m_ + k]);
+        }
+      }
+      double scale = 1 / a[(std::size_t)col * m_ + col];
+      for (int k = 0; k < m_; k++) {
+        a[(std::size_t)col * m_ + k] *= scale;
+        inverse_[(std::size_t)col * m_ + k] *= scale;
+      }
+      for (int i = 0; i < m_; i++) {
+        double factor = a[(std::size_t)i * m_ + col];
+        if (i == col || factor == 0) continue;
+        for (int k = 0; k < m_; k++) {
+          a[(std::size_t)i * m_ + k] -= factor * a[(std::size_t)col * m_ + k];
+          inverse_[(std::size_t)i * m_ + k] -= factor * inverse_[(std::size_t)col * m_ + k];
+        }
+      }
+    }
+
+    // value = B^-1 (b - sum of the nonbasic columns at their upper bound)
+    std::vector<double> rhs = b_;
+    for (int j = 0; j < n_; j++) {
+      if (position_[j] == -1 && at_upper_[j]) {
+        for (const Entry& e : columns_[j]) rhs[e.row] -= e.value * upper_[j];
+      }
+    }
+    value_.assign(m_, 0);
+    for (int i = 0; i < m_; i++) {
+      double sum = 0;
+      for (int k = 0; k < m_; k++) sum += inverse_[(std::size_t)i * m_ + k] * rhs[k];
+      value_[i] = sum;
+    }
+  }
+
+  int m_, n_;
+  const std::vector<std::vector<Entry>>& columns_;
+  const std::vector<double>& cost_;
+  std::vector<double> upper_, b_, inverse_, value_;
+  std::vector<int> basis_, position_;
+  std::vector<char> at_upper_;
+};
+
+struct PackingResult {
+  std::vector<long long> copies;   // x_c
+  long long transplants = 0;       // objective of copies
+  long long bound = 0;             // floor of the root relaxation
+  long long nodes = 0;
+  bool optimal = false;            // false if node_limit stopped the search
+                                   // short of the root bound
+};
+
+// Solves the cycle packing program above. After node_limit nodes the best
+// packing found so far is returned with optimal = false.
+inline PackingResult pack_class_cycles(const CycleSet& cycles, const std::vector<int>& count,
+                                       long long node_limit) {
+  const int m = (int)count.size();
+  const int n = cycles.size();
+  std::vector<std::vector<BoundedSimplex::Entry>> columns(n);
+  std::vector<double> cost(n), upper(n), b(count.begin(), count.end());
+  std::vector<int> mult(m, 0);
+  for (int c = 0; c < n; c++) {
+    for (int k = cycles.start[c]; k < cycles.start[c + 1]; k++) mult[cycles.members[k]]++;
+    double copies = std::numeric_limits<double>::infinity();
+    for (int k = cycles.start[c]; k < cycles.start[c + 1]; k++) {
+      int cls = cycles.members[k];
+      if (mult[cls] == 0) continue;
+      columns[c].push_back({cls, (double)mult[cls]});
+      copies = std::min(copies, std::floor(count[cls] / (double)mult[cls]));
+      mult[cls] = 0;
+    }
+    cost[c] = cycles.length(c);
+    upper[c] = copies;
+  }
+  BoundedSimplex simplex(m, columns, cost);
+
+  PackingResult result;
+  result.copies.assign(n, 0);
+  std::vector<double> lower(n, 0);
+
+  // Rounds x down and fills the remaining pairs greedily, longest cycles
+  // first; keeps the packing if it beats the incumbent
+  std::vector<int> by_length(n);
+  for (int c = 0; c < n; c++) by_length[c] = c;
+  std::stable_sort(by_length.begin(), by_length.end(),
+                   [&](int p, int q) { return cost[p] > cost[q]; });
+  std::vector<long long> candidate(n);
+  std::vector<double> left(m);
+  auto round_and_fill = [&](const std::vector<double>& x) {
+    left = b;
+    for (int c = 0; c < n; c++) {
+      candidate[c] = (long long)std::floor(lower[c] + x[c] + 1e-6);
+      for (const auto& e : columns[c]) left[e.row] -= e.value * candidate[c];
+    }
+    long long value = 0;
+    for (int c : by_length) {
+      double room = std::numeric_limits<double>::infinity();
+      for (const auto& e : columns[c]) room = std::min(room, std::floor((left[e.row] + 1e-6) / e.value));
+      if (room > 0) {
+        candidate[c] += (long long)room;
+        for (const auto& e : columns[c]) left[e.row] -= e.value * room;
+      }
+      value += candidate[c] * (long long)cost[c];
+    }
+    if (value > result.transplants) {
+      result.transplants = value;
+      result.copies = candidate;
+    }
+  };
+
+  // Depth-first search; each node solves the relaxation shifted by the
+  // lower bounds fixed so far (x = lower + x', 0 <= x' <= upper - lower)
+  std::vector<double> node_b(m), node_upper(n), x;
+  bool stopped = false;
+  auto search = [&](auto& self) -> void {
+    if (stopped) return;
+    if (++result.nodes > node_limit) {
+      stopped = true;
+      return;
+    }
+    node_b = b;
+    double fixed = 0;
+    for (int c = 0; c < n; c++) {
+      node_upper[c] = upper[c] - lower[c];
+      if (node_upper[c] < -BoundedSimplex::eps) return;
+      if (lower[c] == 0) continue;
+      fixed += cost[c] * lower[c];
+      for (const auto& e : columns[c]) node_b[e.row] -= e.value * lower[c];
+    }
+    double relaxed = simplex.solve(node_b, node_upper, x);
+    if (!std::isfinite(relaxed)) return;
+    long long node_bound = (long long)std::floor(fixed + relaxed + 1e-6);
+    if (result.nodes == 1) result.bound = node_bound;
+    if (node_bound <= result.transplants) return;
+
+    round_and_fill(x);
+    if (node_bound <= result.transplants) return;
+
+    // Branch on the most fractional copy count, rounding up first
+    int branch = -1;
+    double most = 1e-6;
+    for (int c = 0; c < n; c++) {
+      double frac = x[c] - std::floor(x[c]);
+      double distance = std::min(frac, 1 - frac);
+      if (distance > most) {
+        most = distance;
+        branch = c;
+      }
+    }
+    if (branch == -1) return;   // integral: already taken by round_and_fill
+    double value = lower[branch] + x[branch];
+    double saved_lower = lower[branch], saved_upper = upper[branch];
+    lower[branch] = std::ceil(value);
+    self(self);
+    lower[branch] = saved_lower;
+    if (result.transplants >= result.bound) return;
+    upper[branch] = std::floor(value);
+    self(self);
+    upper[branch] = saved_upper;
+  };
+  search(search);
+  result.optimal = !stopped || result.transplants >= result.bound;
+  return result;
+}
+
+// Concrete cycles: copies[c] copies of each class cycle c, each filled with
+// the next unused pairs of its classes (pair_class[p] in 0..n_classes-1,
+// or -1 for a pair that takes part in nothing). pair_cycles receives the
+// pairs of every cycle in the order of its class cycle: the donor of each
+// pair gives to the patient of the next one.
+inline void realize_class_cycles(const CycleSet& cycles, const std::vector<long long>& copies,
+                                 int n_classes, const std::vector<int>& pair_class,
+                                 CycleSet& pair_cycles) {
+  std::vector<int> start(n_classes + 1, 0), order(pair_class.size());
+  for (int c : pair_class) {
+    if (c >= 0) start[c + 1]++;
+  }
+  for (int k = 0; k < n_classes; k++) start[k + 1] += start[k];
+  std::vector<int> next(start.begin(), start.end() - 1);
+  for (int p = 0; p < (int)pair_class.size(); p++) {
+    if (pair_class[p] >= 0) order[next[pair_class[p]]++] = p;
+  }
+
+  std::copy(start.begin(), start.end() - 1, next.begin());
+  pair_cycles = CycleSet();
+  std::vector<int> members;
+  for (int c = 0; c < cycles.size(); c++) {
+    for (long long copy = 0; copy < copies[c]; copy++) {
+      members.clear();
+      for (int k = cycles.start[c]; k < cycles.start[c + 1]; k++) {
+        members.push_back(order[next[cycles.members[k]]++]);
+      }
+      pair_cycles.add(members.data(), (int)members.size());
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,136 @@
+// Certificates for the results of the matching engines.
+//
+// Stability: a pair (h, f) blocks a matching when h prefers f to his wife
+// and f prefers h to her husband. first_blocking_man() scans each man's
+// list only up to his wife, so a run is O(n^2) at worst and usually far
+// less. Men are split between the threads of a pool; a thread stops as
+// soon as a lower man is known to block, so the answer is the lowest
+// blocking man whatever the number of threads.
+//
+// Maximality (Berge): a bipartite matching is maximum iff no augmenting
+// path exists. find_augmenting_path() grows one alternating BFS forest
+// from all free left vertices at once, O(V + E).
+#ifndef CHT_MATCHING_VERIFIER_H
+#define CHT_MATCHING_VERIFIER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "bipartite_matching.h"
+#include "worker_pool.h"
+
+// Lowest man h in a blocking pair of the matching, or -1 if it is stable.
+// wife[h] and husband[f] are -1 for unmatched agents; an unmatched woman
+// takes any man. prefs follows the interface of gs_bucket_solve() (a man
+// only lists the first prefs.list_length(h) women). woman receives the
+// first woman of h's list who blocks with him.
+template <typename Prefs>
+int first_blocking_man(const Prefs& prefs, const std::vector<int>& wife,
+                       const std::vector<int>& husband, WorkerPool& pool, int& woman) {
+  const int n = prefs.size();
+  std::atomic<int> lowest(n);
+  std::vector<int> blocking_man(pool.size(), -1), blocking_woman(pool.size(), -1);
+  pool.parallel_for(n, [&](std::size_t begin, std::size_t end, int t) {
+    for (int h = (int)begin; h < (int)end; h++) {
+      if (h >= lowest.load(std::memory_order_relaxed)) return;
+      const int length = prefs.list_length(h);
+      for (int k = 0; k < length; k++) {
+        int f = prefs.man_choice(h, k);
+        if (f == wife[h]) break;
+        int rival = husband[f];
+        if (rival == -1 || prefs.woman_rank(f, h) < prefs.woman_rank(f, rival)) {
+          blocking_man[t] = h;
+          blocking_woman[t] = f;
+          int seen = lowest.load();
+          while (h < seen && !lowest.compare_exchange_weak(seen, h)) {
+          }
+          return;
+        }
+      }
+    }
+  });
+
+  int man = lowest.load();
+  if (man == n) return -1;
+  for (int t = 0; t < pool.size(); t++) {
+    if (blocking_man[t] == man) woman = blocking_woman[t];
+  }
+  return man;
+}
+
+// Number of men whose wife in matching they rank below their wife in
+// reference (being unmatched is worst). first_man receives the lowest of
+// them, or -1. Against the man-optimal matching, a stable matching has no
+// such man exactly when it is the man-optimal matching itself.
+template <typename Prefs>
+long long count_men_worse_off(const Prefs& prefs, const std::vector<int>& wife,
+                              const std::vector<int>& reference, WorkerPool& pool,
+                              int& first_man) {
+  const int n = prefs.size();
+  std::vector<long long> worse(pool.size(), 0);
+  std::vector<int> first(pool.size(), -1);
+  pool.parallel_for(n, [&](std::size_t begin, std::size_t end, int t) {
+    for (int h = (int)begin; h < (int)end; h++) {
+      if (wife[h] == reference[h] || reference[h] == -1) continue;
+      bool is_worse = wife[h] == -1;
+      const int length = prefs.list_length(h);
+      for (int k = 0; k < length && !is_worse; k++) {
+        int f = prefs.man_choice(h, k);
+        if (f == wife[h]) break;
+        is_worse = f == reference[h];
+      }
+      if (is_worse) {
+        if (first[t] == -1) first[t] = h;
+        worse[t]++;
+      }
+    }
+  });
+
+  long long total = 0;
+  first_man = -1;
+  for (int t = 0; t < pool.size(); t++) {
+    total += worse[t];
+    if (first_man == -1) first_man = first[t];
+  }
+  return total;
+}
+
+// Fills path with an augmenting path of the matching, as alternating left
+// and right vertices u0, v0, u1, v1, ..., uk, vk: u0 is free, vk is free,
+// each (ui, vi) is an edge outside the matching and vi is matched to
+// u(i+1). Returns false (path empty) when the matching is maximum.
+inline bool find_augmenting_path(const BipartiteGraph& graph, const std::vector<int>& match_left,
+                                 const std::vector<int>& match_right, std::vector<int>& path) {
+  path.clear();
+  // parent[v] = left vertex from which right vertex v was reached
+  std::vector<int> parent(graph.n_right, -1);
+  std::vector<int> queue;
+  queue.reserve(graph.n_left);
+  for (int u = 0; u < graph.n_left; u++) {
+    if (match_left[u] == -1) queue.push_back(u);
+  }
+
+  for (std::size_t head = 0; head < queue.size(); head++) {
+    int u = queue[head];
+    for (int64_t e = graph.start[u]; e < graph.start[u + 1]; e++) {
+      int v = graph.adj[e];
+      if (parent[v] != -1 || v == match_left[u]) continue;
+      parent[v] = u;
+      if (match_right[v] == -1) {
+        // Walk back to a free left vertex
+        for (int w = v; w != -1; w = match_left[parent[w]]) {
+          path.push_back(w);
+          path.push_back(parent[w]);
+        }
+        std::reverse(path.begin(), path.end());
+        return true;
+      }
+      queue.push_back(match_right[v]);
+    }
+  }
+  return false;
+}
+
+#endif
@@ -0,0 +1,111 @@
+// Dinic maximum flow on an explicit graph.
+//
+// Used for minimum cuts (maximum-weight closures of the rotation poset) and
+// for flows on small class graphs. The blocking-flow search is iterative,
+// so long chains such as rotation posets cannot overflow the call stack.
+#ifndef CHT_MAX_FLOW_H
+#define CHT_MAX_FLOW_H
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+class MaxFlow {
+public:
+  static constexpr long long infinite = std::numeric_limits<long long>::max() / 4;
+
+  explicit MaxFlow(int n_nodes) : head_(n_nodes, -1), level_(n_nodes), it_(n_nodes) {}
+
+  int n_nodes() const { return (int)head_.size(); }
+
+  // Adds the arc from -> to and returns its id; the reverse arc is id ^ 1.
+  int add_edge(int from, int to, long long capacity) {
+    int id = (int)to_.size();
+    push_arc(from, to, capacity);
+    push_arc(to, from, 0);
+    return id;
+  }
+
+  // Pushes as much flow as possible from s to t and returns its value.
+  long long solve(int s, int t) {
+    long long total = 0;
+    std::vector<int> path;
+    while (bfs(s, t)) {
+      it_ = head_;
+      int v = s;
+      while (true) {
+        if (v == t) {
+          long long push = infinite;
+          for (int e : path) push = std::min(push, cap_[e]);
+          std::size_t cut = path.size();
+          for (std::size_t i = 0; i < path.size(); i++) {
+            cap_[path[i]] -= push;
+            cap_[path[i] ^ 1] += push;
+            if (cap_[path[i]] == 0 && cut == path.size()) cut = i;
+          }
+          total += push;
+          // Restart from the tail of the first saturated arc
+          path.resize(cut);
+          v = path.empty() ? s : to_[path.back()];
+          continue;
+        }
+
+        int e = it_[v];
+        while (e != -1 && (cap_[e] == 0 || level_[to_[e]] != level_[v] + 1)) e = next_[e];
+        it_[v] = e;
+        if (e != -1) {
+          path.push_back(e);
+          v = to_[e];
+          continue;
+        }
+
+        // Dead end: retreat
+        if (v == s) break;
+        level_[v] = -1;
+        int back = path.back();
+        path.pop_back();
+        v = to_[back ^ 1];
+        it_[v] = next_[it_[v]];
+      }
+    }
+    return total;
+  }
+
+  // After solve(): whether v is on the source side of the minimum cut.
+  bool source_side(int v) const { return level_[v] != -1; }
+
+  // Flow currently carried by the arc id returned by add_edge().
+  long long flow(int id) const { return cap_[id ^ 1]; }
+
+private:
+  void push_arc(int from, int to, long long capacity) {
+    to_.push_back(to);
+    cap_.push_back(capacity);
+    next_.push_back(head_[from]);
+    head_[from] = (int)to_.size() - 1;
+  }
+
+  // Levels from s in the residual graph. The last search is the one that
+  // fails to reach t, so its reachable set is the source side of the cut.
+  bool bfs(int s, int t) {
+    std::fill(level_.begin(), level_.end(), -1);
+    std::vector<int> queue(1, s);
+    level_[s] = 0;
+    for (std::size_t i = 0; i < queue.size(); i++) {
+      int v = queue[i];
+      for (int e = head_[v]; e != -1; e = next_[e]) {
+        if (cap_[e] > 0 && level_[to_[e]] == -1) {
+          level_[to_[e]] = level_[v] + 1;
+          queue.push_back(to_[e]);
+        }
+      }
+    }
+    return level_[t] != -1;
+  }
+
+  std::vector<int> head_, next_, to_;
+  std::vector<long long> cap_;
+  std::vector<int> level_, it_;
+};
+
+#endif
@@ -0,0 +1,289 @@
+// Maximum bipartite matching kept up to date as donors and recipients come
+// and go, when compatibility only depends on classes (blood types).
+//
+// A matching is maximum iff it has no augmenting path (Berge). If it is
+// maximum before an event, only the affected vertex can start one after:
+//  - an arriving vertex is the only new free vertex;
+//  - when a matched vertex leaves, its partner is the only new free vertex.
+// So each event runs a single search, from that vertex, and the matching
+// stays maximum after every event.
+//
+// The search never looks at individual agents. Agents of one class are
+// interchangeable, so an alternating path only needs, at each step, some
+// pair between a donor class and a recipient class, or some free agent of
+// a class. Free agents are kept in one list per class and matched pairs in
+// one list per (donor class, recipient class), which makes the search a BFS
+// over the K classes: O(K^2) per event whatever the number of agents, and
+// flipping the path takes one pair per step. Slots of departed agents are
+// reused, so memory follows the live population.
+#ifndef CHT_ONLINE_MATCHING_ENGINE_H
+#define CHT_ONLINE_MATCHING_ENGINE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+class OnlineClassMatcher {
+public:
+  // compatible is n_classes x n_classes, row-major (donor class, recipient
+  // class).
+  OnlineClassMatcher(int n_classes, const std::vector<char>& compatible)
+      : n_classes_(n_classes), compatible_(compatible),
+        free_donors_(n_classes), free_recipients_(n_classes),
+        pairs_((std::size_t)n_classes * n_classes),
+        donor_parent_(n_classes), recipient_parent_(n_classes) {}
+
+  int size() const { return size_; }
+  int n_donor_slots() const { return (int)donors_.size(); }
+  int n_recipient_slots() const { return (int)recipients_.size(); }
+  bool donor_active(int d) const { return donors_[d].active; }
+  bool recipient_active(int r) const { return recipients_[r].active; }
+  int partner_of_donor(int d) const { return donors_[d].partner; }
+  int partner_of_recipient(int r) const { return recipients_[r].partner; }
+
+  // Class arcs scanned by the searches since the counter was last read.
+  long long take_work() {
+    long long work = work_;
+    work_ = 0;
+    return work;
+  }
+
+  // Adds a donor of class cls (-1: compatible with nobody) and returns its
+  // slot; it is matched at once if an augmenting path starts from it.
+  int add_donor(int cls) {
+    int d = new_slot(donors_, free_donor_slots_, cls);
+    if (cls >= 0) {
+      push(free_donors_[cls], donors_, d);
+      augment_from_donor(d);
+    }
+    return d;
+  }
+
+  int add_recipient(int cls) {
+    int r = new_slot(recipients_, free_recipient_slots_, cls);
+    if (cls >= 0) {
+      push(free_recipients_[cls], recipients_, r);
+      augment_from_recipient(r);
+    }
+    return r;
+  }
+
+  // A departing donor frees its recipient, which then looks for a new
+  // partner.
+  void remove_donor(int d) {
+    Agent& donor = donors_[d];
+    if (!donor.active) return;
+    int r = donor.partner;
+    if (r != -1) {
+      unmatch(d);
+      push(free_recipients_[recipients_[r].cls], recipients_, r);
+    } else if (donor.cls >= 0) {
+      pop(free_donors_[donor.cls], donors_, d);
+    }
+    donor.active = false;
+    free_donor_slots_.push_back(d);
+    if (r != -1) augment_from_recipient(r);
+  }
+
+  void remove_recipient(int r) {
+    Agent& recipient = recipients_[r];
+    if (!recipient.active) return;
+    int d = recipient.partner;
+    if (d != -1) {
+      unmatch(d);
+      push(free_donors_[donors_[d].cls], donors_, d);
+    } else if (recipient.cls >= 0) {
+      pop(free_recipients_[recipient.cls], recipients_, r);
+    }
+    recipient.active = false;
+    free_recipient_slots_.push_back(r);
+    if (d != -1) augment_from_donor(d);
+  }
+
+private:
+  struct Agent {
+    int cls = -1;
+    int partner = -1;
+    int pos = -1;  // position in its free list or (donors) its pair list
+    bool active = false;
+  };
+
+  static int new_slot(std::vector<Agent>& agents, std::vector<int>& free_slots, int cls) {
+    int slot;
+    if (free_slots.empty()) {
+      slot = (int)agents.size();
+      agents.emplace_back();
+    } else {
+      slot = free_slots.back();
+      free_slots.pop_back();
+    }
+    agents[slot] = Agent();
+    agents[slot].cls = cls;
+    agents[slot].active = true;
+    return slot;
+  }
+
+  static void push(std::vector<int>& list, std::vector<Agent>& agents, int x) {
+    agents[x].pos = (int)list.size();
+    list.push_back(x);
+  }
+
+  // Removes x from list in O(1); the last element takes its place
+  static void pop(std::vector<int>& list, std::vector<Agent>& agents, int x) {
+    int last = list.back();
+    list[agents[x].pos] = last;
+    agents[last].pos = agents[x].pos;
+    list.pop_back();
+    agents[x].pos = -1;
+  }
+
+  std::vector<int>& pairs(int donor_class, int recipient_class) {
+    return pairs_[(std::size_t)donor_class * n_classes_ + recipient_class];
+  }
+
+  // Unlisted donor d takes unlisted recipient r
+  void match(int d, int r) {
+    donors_[d].partner = r;
+    recipients_[r].partner = d;
+    push(pairs(donors_[d].cls, recipients_[r].cls), donors_, d);
+  }
+
+  // Breaks the pair of donor d; both sides are left out of every list
+  void unmatch(int d) {
+    int r = donors_[d].partner;
+    pop(pairs(donors_[d].cls, recipients_[r].cls), donors_, d);
+    donors_[d].partner = -1;
+    recipients_[r].partner = -1;
+    size_--;
+  }
+
+  // BFS over donor classes from the class of free donor d: recipient class
+  // b is a way out if it has a free recipient, otherwise a donor class c
+  // with a (c, b) pair is reached (that donor can give up its recipient).
+  void augment_from_donor(int d) {
+    const int K = n_classes_;
+    std::vector<int>& donor_parent = donor_parent_;        // recipient class
+    std::vector<int>& recipient_parent = recipient_parent_;  // donor class
+    std::fill(donor_parent.begin(), donor_parent.end(), unseen);
+    std::fill(recipient_parent.begin(), recipient_parent.end(), unseen);
+    queue_.clear();
+    queue_.push_back(donors_[d].cls);
+    donor_parent[donors_[d].cls] = root;
+    int exit = -1;
+    for (std::size_t i = 0; i < queue_.size() && exit == -1; i++) {
+      int a = queue_[i];
+      for (int b = 0; b < K; b++) {
+        work_++;
+        if (!compatible_[(std::size_t)a * K + b] || recipient_parent[b] != unseen) continue;
+        recipient_parent[b] = a;
+        if (!free_recipients_[b].empty()) {
+          exit = b;
+          break;
+        }
+        for (int c = 0; c < K; c++) {
+          if (donor_parent[c] == unseen && !pairs(c, b).empty()) {
+            donor_parent[c] = b;
+            queue_.push_back(c);
+          }
+        }
+      }
+    }
+    if (exit == -1) return;
+
+    // Walk back from the free recipient: a donor of the class before it
+    // moves to it and releases its own recipient, until the root class
+    pop(free_donors_[donors_[d].cls], donors_, d);
+    int b = exit;
+    int r = free_recipients_[b].back();
+    pop(free_recipients_[b], recipients_, r);
+    while (true) {
+      int a = recipient_parent[b];
+      if (donor_parent[a] == root) {
+        match(d, r);
+        break;
+      }
+      int previous_class = donor_parent[a];
+      int giver = pairs(a, previous_class).back();
+      int released = donors_[giver].partner;
+      pop(pairs(a, previous_class), donors_, giver);
+      donors_[giver].partner = -1;
+      recipients_[released].partner = -1;
+      match(giver, r);
+      r = released;
+      b = previous_class;
+    }
+    size_++;
+  }
+
+  // Mirror image: BFS over recipient classes from the class of free
+  // recipient r.
+  void augment_from_recipient(int r) {
+    const int K = n_classes_;
+    std::vector<int>& recipient_parent = recipient_parent_;  // donor class
+    std::vector<int>& donor_parent = donor_parent_;        // recipient class
+    std::fill(donor_parent.begin(), donor_parent.end(), unseen);
+    std::fill(recipient_parent.begin(), recipient_parent.end(), unseen);
+    queue_.clear();
+    queue_.push_back(recipients_[r].cls);
+    recipient_parent[recipients_[r].cls] = root;
+    int exit = -1;
+    for (std::size_t i = 0; i < queue_.size() && exit == -1; i++) {
+      int b = queue_[i];
+      for (int a = 0; a < K; a++) {
+        work_++;
+        if (!compatible_[(std::size_t)a * K + b] || donor_parent[a] != unseen) continue;
+        donor_parent[a] = b;
+        if (!free_donors_[a].empty()) {
+          exit = a;
+          break;
+        }
+        for (int c = 0; c < K; c++) {
+          if (recipient_parent[c] == unseen && !pairs(a, c).empty()) {
+            recipient_parent[c] = a;
+            queue_.push_back(c);
+          }
+        }
+      }
+    }
+    if (exit == -1) return;
+
+    pop(free_recipients_[recipients_[r].cls], recipients_, r);
+    int a = exit;
+    int d = free_donors_[a].back();
+    pop(free_donors_[a], donors_, d);
+    while (true) {
+      int b = donor_parent[a];
+      if (recipient_parent[b] == root) {
+        match(d, r);
+        break;
+      }
+      // d takes the recipient of some donor of class recipient_parent[b]
+      // matched in class b, which then needs a new one
+      int next_class = recipient_parent[b];
+      int taker = pairs(next_class, b).back();
+      int taken = donors_[taker].partner;
+      pop(pairs(next_class, b), donors_, taker);
+      donors_[taker].partner = -1;
+      recipients_[taken].partner = -1;
+      match(d, taken);
+      d = taker;
+      a = next_class;
+    }
+    size_++;
+  }
+
+  static constexpr int unseen = -2;
+  static constexpr int root = -1;
+
+  int n_classes_;
+  std::vector<char> compatible_;
+  std::vector<Agent> donors_, recipients_;
+  std::vector<int> free_donor_slots_, free_recipient_slots_;
+  std::vector<std::vector<int>> free_donors_, free_recipients_;
+  std::vector<std::vector<int>> pairs_;  // donors, per (donor class, recipient class)
+  std::vector<int> donor_parent_, recipient_parent_, queue_;
+  int size_ = 0;
+  long long work_ = 0;
+};
+
+#endif
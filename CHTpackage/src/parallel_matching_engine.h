@@ -0,0 +1,186 @@
+// Multithreaded Hopcroft-Karp on a CSR graph.
+//
+// Each phase is the same as in HopcroftKarp, with both halves spread over
+// a WorkerPool:
+//  - the BFS is level-synchronous: threads split the current frontier and
+//    claim the next layer's left vertices with a compare-and-swap on their
+//    distance, so every vertex enters the frontier once;
+//  - the DFS runs from many free donors at once. A thread must claim a
+//    right vertex (atomic flag, once per phase) before stepping through it,
+//    so the paths of different threads are vertex-disjoint and each thread
+//    only writes the matching entries of vertices it owns.
+// Two threads can block each other's only paths, so a phase may end with
+// no augmentation even though the BFS found one; the matching is then
+// finished with the serial engine on the same state. Small graphs go to
+// the serial engine directly.
+#ifndef CHT_PARALLEL_MATCHING_ENGINE_H
+#define CHT_PARALLEL_MATCHING_ENGINE_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "bipartite_matching.h"
+#include "worker_pool.h"
+
+// Augments the (valid) matching in match_left / match_right to a maximum
+// one and returns its size; *phases receives the number of phases run,
+// serial ones included. Every phase is reported to stats (see
+// solver_stats.h).
+template <typename Stats>
+int parallel_hopcroft_karp(const BipartiteGraph& graph, std::vector<int>& match_left,
+                           std::vector<int>& match_right, WorkerPool& pool, Stats& stats,
+                           int* phases = nullptr) {
+  const int n_left = graph.n_left, n_right = graph.n_right;
+  const int n_threads = pool.size();
+  const int unreached = -1;
+  int n_phases = 0;
+
+  auto finish_serially = [&]() {
+    HopcroftKarp serial;
+    int size = serial.augment(graph, match_left, match_right, stats);
+    if (phases) *phases = n_phases + serial.phases();
+    return size;
+  };
+  if (n_threads == 1 || n_left < 1024 * n_threads) return finish_serially();
+
+  std::vector<std::atomic<int>> partner(n_right);  // match_right, shared
+  for (int v = 0; v < n_right; v++) partner[v].store(match_right[v], std::memory_order_relaxed);
+  std::vector<std::atomic<int>> dist(n_left);
+  std::vector<std::atomic<char>> claimed(n_right);
+  std::vector<int64_t> it(n_left);
+
+  std::vector<int> frontier, roots;
+  std::vector<std::vector<int>> next_frontier(n_threads);
+  std::vector<std::vector<int>> stacks(n_threads);
+  std::vector<int> augmented(n_threads);
+
+  auto copy_back = [&]() {
+    for (int v = 0; v < n_right; v++) match_right[v] = partner[v].load(std::memory_order_relaxed);
+  };
+
+  while (true) {
+    stats.phase_begin();
+    // BFS from the free donors, one layer per round
+    frontier.clear();
+    for (int u = 0; u < n_left; u++) {
+      bool is_free = match_left[u] == -1;
+      dist[u].store(is_free ? 0 : unreached, std::memory_order_relaxed);
+      if (is_free) frontier.push_back(u);
+    }
+    roots = frontier;
+    std::atomic<bool> found_free(false);
+    int layer = 0;
+    while (!frontier.empty()) {
+      // Threads with an empty chunk are not called, so clear every output here
+      for (auto& out : next_frontier) out.clear();
+      pool.parallel_for(frontier.size(), [&](std::size_t begin, std::size_t end, int t) {
+        std::vector<int>& out = next_frontier[t];
+        bool found = false;
+        for (std::size_t i = begin; i < end; i++) {
+          int u = frontier[i];
+          for (int64_t e = graph.start[u]; e < graph.start[u + 1]; e++) {
+            int w = partner[graph.adj[e]].load(std::memory_order_relaxed);
+            if (w == -1) {
+              found = true;
+              continue;
+            }
+            int expected = unreached;
+            if (dist[w].load(std::memory_order_relaxed) == unreached &&
+                dist[w].compare_exchange_strong(expected, layer + 1, std::memory_order_relaxed)) {
+              out.push_back(w);
+            }
+          }
+        }
+        if (found) found_free.store(true, std::memory_order_relaxed);
+      });
+      if (found_free.load(std::memory_order_relaxed)) break;
+      frontier.clear();
+      for (auto& out : next_frontier) frontier.insert(frontier.end(), out.begin(), out.end());
+      layer++;
+    }
+    if (!found_free.load(std::memory_order_relaxed)) break;
+    const int free_layer = layer + 1;
+    n_phases++;
+
+    // Vertex-disjoint augmentations; roots are handed out in small batches
+    pool.parallel_for(n_left, [&](std::size_t begin, std::size_t end, int) {
+      for (std::size_t u = begin; u < end; u++) it[u] = graph.start[u];
+    });
+    pool.parallel_for(n_right, [&](std::size_t begin, std::size_t end, int) {
+      for (std::size_t v = begin; v < end; v++) claimed[v].store(0, std::memory_order_relaxed);
+    });
+    std::atomic<std::size_t> next_root(0);
+    pool.run([&](int t) {
+      std::vector<int>& stack = stacks[t];
+      int count = 0;
+      const std::size_t batch = 64;
+      while (true) {
+        std::size_t first = next_root.fetch_add(batch, std::memory_order_relaxed);
+        if (first >= roots.size()) break;
+        std::size_t last = std::min(roots.size(), first + batch);
+        for (std::size_t r = first; r < last; r++) {
+          stack.clear();
+          stack.push_back(roots[r]);
+          while (!stack.empty()) {
+            int u = stack.back();
+            int du = dist[u].load(std::memory_order_relaxed);
+            bool pushed = false, done = false;
+            for (int64_t& e = it[u]; e < graph.start[u + 1]; e++) {
+              int v = graph.adj[e];
+              int w = partner[v].load(std::memory_order_relaxed);
+              if (w == -1 ? du + 1 != free_layer
+                          : dist[w].load(std::memory_order_relaxed) != du + 1) continue;
+              if (claimed[v].exchange(1, std::memory_order_acq_rel)) continue;
+              // v is ours now, so its partner cannot have changed
+              if (w == -1) {
+                for (int x : stack) {
+                  int y = graph.adj[it[x]++];
+                  match_left[x] = y;
+                  partner[y].store(x, std::memory_order_relaxed);
+                }
+                count++;
+                done = true;
+              } else {
+                stack.push_back(w);
+                pushed = true;
+              }
+              break;
+            }
+            if (done) break;
+            if (pushed) continue;
+            dist[u].store(unreached, std::memory_order_relaxed);
+            stack.pop_back();
+            if (!stack.empty()) it[stack.back()]++;
+          }
+        }
+      }
+      augmented[t] = count;
+    });
+
+    int total = 0;
+    for (int c : augmented) total += c;
+    stats.phase_end(2 * free_layer - 1, total);
+    if (total == 0) {
+      // Threads blocked each other: finish on one thread
+      copy_back();
+      return finish_serially();
+    }
+  }
+
+  copy_back();
+  if (phases) *phases = n_phases;
+  int size = 0;
+  for (int u = 0; u < n_left; u++) size += match_left[u] != -1;
+  return size;
+}
+
+inline int parallel_hopcroft_karp(const BipartiteGraph& graph, std::vector<int>& match_left,
+                                  std::vector<int>& match_right, WorkerPool& pool,
+                                  int* phases = nullptr) {
+  NullStats stats;
+  return parallel_hopcroft_karp(graph, match_left, match_right, pool, stats, phases);
+}
+
+#endif
@@ -0,0 +1,64 @@
+// Instrumentation policies of the matching engines.
+//
+// The engines take a Stats object by reference and call its hooks at the
+// points of interest (a proposal, a rejection, a bucket push or pop, the
+// start and end of a Hopcroft-Karp phase). They are templates on the
+// policy, so the choice is made at compile time:
+//  - NullStats has empty inline hooks; the calls vanish and the hot loops
+//    compile to the same code as without instrumentation. The plain entry
+//    points of the engines use it.
+//  - SolverStats counts and times; the R functions instantiate it only
+//    when asked for stats, which makes it a runtime switch as well.
+#ifndef CHT_SOLVER_STATS_H
+#define CHT_SOLVER_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <vector>
+
+struct NullStats {
+  void proposal() {}
+  void rejection() {}
+  void bucket_push(int) {}
+  void bucket_pop(int) {}
+  void phase_begin() {}
+  void phase_end(int, int) {}
+};
+
+struct SolverStats {
+  long long proposals = 0;
+  long long rejections = 0;
+  int max_bucket_depth = 0;
+  int phases = 0;
+  // path_count[k]: augmenting paths of k edges
+  std::vector<long long> path_count;
+  std::vector<double> phase_seconds;
+
+  void proposal() { proposals++; }
+  void rejection() { rejections++; }
+
+  void bucket_push(int bucket) {
+    if (bucket >= (int)bucket_size_.size()) bucket_size_.resize(bucket + 1, 0);
+    max_bucket_depth = std::max(max_bucket_depth, ++bucket_size_[bucket]);
+  }
+  void bucket_pop(int bucket) { bucket_size_[bucket]--; }
+
+  void phase_begin() { phase_start_ = std::chrono::steady_clock::now(); }
+
+  // A phase augments along paths of the same length: paths of
+  // path_length edges were found
+  void phase_end(int path_length, int paths) {
+    phases++;
+    phase_seconds.push_back(
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - phase_start_).count());
+    if (path_length >= (int)path_count.size()) path_count.resize(path_length + 1, 0);
+    path_count[path_length] += paths;
+  }
+
+private:
+  std::vector<int> bucket_size_;
+  std::chrono::steady_clock::time_point phase_start_;
+};
+
+#endif
@@ -0,0 +1,378 @@
+// Rotation poset of a complete n x n stable marriage instance.
+//
+// All stable matchings lie between the man-optimal matching M0 and the
+// woman-optimal matching Mz, and each of them is M0 with a closed set of
+// rotations eliminated (Gusfield & Irving, "The Stable Marriage Problem").
+// build() runs both Gale-Shapley directions, then finds every rotation by
+// walking from M0 to Mz with the stack method: each man's search pointer
+// only moves down his list, so the walk is O(n^2). Precedences come from
+// two rules, also O(n^2) in total:
+//  1. rotations that move the same man are ordered along his list;
+//  2. if rho moves m past a woman w (w strictly between his old and new
+//     partner), the rotation that gives w a partner she prefers to m must
+//     come first.
+// The optimal matchings are then closures of this poset:
+//  - minimum regret: only forced moves are made (the rotation improving the
+//    woman of largest regret, with its predecessors), keeping the best
+//    matching seen, as in Gusfield's algorithm;
+//  - egalitarian: a minimum-weight closure, found as a minimum cut.
+// Ranks are 1-based everywhere: the regret of a matching is the largest
+// rank an agent gives its partner, its egalitarian cost the sum of ranks.
+#ifndef CHT_STABLE_LATTICE_ENGINE_H
+#define CHT_STABLE_LATTICE_ENGINE_H
+
+#include <algorithm>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+#include "max_flow.h"
+
+class RotationPoset {
+public:
+  // men_pref[m * n + k] = k-th woman of man m, women_pref likewise (0-based
+  // ids, complete lists).
+  void build(int n, const int* men_pref, const int* women_pref) {
+    n_ = n;
+    men_pref_.assign(men_pref, men_pref + (std::size_t)n * n);
+    women_pref_.assign(women_pref, women_pref + (std::size_t)n * n);
+    men_rank_.resize((std::size_t)n * n);
+    women_rank_.resize((std::size_t)n * n);
+    for (int a = 0; a < n; a++) {
+      for (int k = 0; k < n; k++) {
+        men_rank_[(std::size_t)a * n + men_pref[(std::size_t)a * n + k]] = k;
+        women_rank_[(std::size_t)a * n + women_pref[(std::size_t)a * n + k]] = k;
+      }
+    }
+
+    std::vector<int> husband;
+    propose(men_pref_, women_rank_, husband);
+    man_optimal_.assign(n, -1);
+    for (int w = 0; w < n; w++) man_optimal_[husband[w]] = w;
+    propose(women_pref_, men_rank_, woman_optimal_);
+
+    find_rotations();
+    build_precedences();
+  }
+
+  int size() const { return n_; }
+  int n_rotations() const { return (int)rotation_start_.size() - 1; }
+
+  // Matchings are given as wife[m].
+  const std::vector<int>& man_optimal() const { return man_optimal_; }
+  const std::vector<int>& woman_optimal() const { return woman_optimal_; }
+
+  // Change of the egalitarian cost when the rotation is eliminated.
+  long long rotation_weight(int r) const { return weight_[r]; }
+
+  // M0 with the rotations of the (closed) set eliminated.
+  std::vector<int> matching_of(const std::vector<char>& in_set) const {
+    std::vector<int> wife = man_optimal_;
+    for (int r = 0; r < n_rotations(); r++) {
+      if (in_set[r]) eliminate(r, wife);
+    }
+    return wife;
+  }
+
+  int regret(const std::vector<int>& wife) const {
+    int worst = 0;
+    for (int m = 0; m < n_; m++) {
+      worst = std::max(worst, man_rank(m, wife[m]) + 1);
+      worst = std::max(worst, woman_rank(wife[m], m) + 1);
+    }
+    return worst;
+  }
+
+  long long egalitarian_cost(const std::vector<int>& wife) const {
+    long long cost = 0;
+    for (int m = 0; m < n_; m++) cost += man_rank(m, wife[m]) + woman_rank(wife[m], m) + 2;
+    return cost;
+  }
+
+  std::vector<int> minimum_regret() const {
+    std::vector<int> wife = man_optimal_;
+    std::vector<int> husband(n_);
+    for (int m = 0; m < n_; m++) husband[wife[m]] = m;
+
+    // Women by current regret, with lazy deletion; men's regret only grows
+    std::vector<std::vector<int>> by_regret(n_ + 1);
+    int men_regret = 0;
+    for (int m = 0; m < n_; m++) {
+      men_regret = std::max(men_regret, man_rank(m, wife[m]) + 1);
+      by_regret[woman_rank(wife[m], m) + 1].push_back(wife[m]);
+    }
+    int women_regret = n_;
+
+    std::vector<char> in_set(n_rotations(), 0);
+    std::vector<int> applied;            // rotations in elimination order
+    std::vector<int> taken(n_, 0);       // rotations of each woman applied so far
+    std::size_t best_prefix = 0;
+    int best = n_ + 1;
+    std::vector<int> stack, order;
+
+    while (true) {
+      while (women_regret > 0) {
+        std::vector<int>& bucket = by_regret[women_regret];
+        while (!bucket.empty() && woman_rank(bucket.back(), husband[bucket.back()]) + 1 != women_regret) {
+          bucket.pop_back();
+        }
+        if (!bucket.empty()) break;
+        women_regret--;
+      }
+      int current = std::max(men_regret, women_regret);
+      if (current < best) {
+        best = current;
+        best_prefix = applied.size();
+      }
+      if (women_regret <= men_regret) break;
+
+      // Forced move: improve the woman of largest regret
+      int w = by_regret[women_regret].back();
+      if (taken[w] == woman_rotations_start_[w + 1] - woman_rotations_start_[w]) break;
+      int target = woman_rotations_[woman_rotations_start_[w] + taken[w]];
+
+      // Target and its missing predecessors, predecessors first
+      order.clear();
+      stack.assign(1, target);
+      in_set[target] = 2;
+      while (!stack.empty()) {
+        int r = stack.back();
+        bool pushed = false;
+        for (int i = pred_start_[r]; i < pred_start_[r + 1]; i++) {
+          int p = pred_[i];
+          if (!in_set[p]) {
+            in_set[p] = 2;
+            stack.push_back(p);
+            pushed = true;
+            break;
+          }
+        }
+        if (!pushed) {
+          stack.pop_back();
+          order.push_back(r);
+        }
+      }
+
+      for (int r : order) {
+        in_set[r] = 1;
+        applied.push_back(r);
+        for (int i = rotation_start_[r]; i < rotation_start_[r + 1]; i++) {
+          int m = rotation_men_[i];
+          int next = i + 1 == rotation_start_[r + 1] ? rotation_start_[r] : i + 1;
+          int new_wife = rotation_women_[next];
+          wife[m] = new_wife;
+          husband[new_wife] = m;
+          taken[new_wife]++;
+          men_regret = std::max(men_regret, man_rank(m, new_wife) + 1);
+          by_regret[woman_rank(new_wife, m) + 1].push_back(new_wife);
+        }
+      }
+    }
+
+    std::vector<char> best_set(n_rotations(), 0);
+    for (std::size_t i = 0; i < best_prefix; i++) best_set[applied[i]] = 1;
+    return matching_of(best_set);
+  }
+
+  std::vector<int> egalitarian() const {
+    // Maximum-profit closure with profit = -weight
+    int n_rot = n_rotations();
+    int source = n_rot, sink = n_rot + 1;
+    MaxFlow flow(n_rot + 2);
+    for (int r = 0; r < n_rot; r++) {
+      if (weight_[r] < 0) flow.add_edge(source, r, -weight_[r]);
+      if (weight_[r] > 0) flow.add_edge(r, sink, weight_[r]);
+      for (int i = pred_start_[r]; i < pred_start_[r + 1]; i++) {
+        flow.add_edge(r, pred_[i], MaxFlow::infinite);
+      }
+    }
+    flow.solve(source, sink);
+
+    std::vector<char> in_set(n_rot, 0);
+    for (int r = 0; r < n_rot; r++) in_set[r] = flow.source_side(r);
+    return matching_of(in_set);
+  }
+
+private:
+  int man_rank(int m, int w) const { return men_rank_[(std::size_t)m * n_ + w]; }
+  int woman_rank(int w, int m) const { return women_rank_[(std::size_t)w * n_ + m]; }
+
+  // Proposals by the side whose lists are given; fills partner[receiver].
+  void propose(const std::vector<int>& pref, const std::vector<int>& rank,
+               std::vector<int>& partner) const {
+    partner.assign(n_, -1);
+    std::vector<int> next(n_, 0);
+    std::vector<int> free_agents(n_);
+    for (int i = 0; i < n_; i++) free_agents[i] = n_ - 1 - i;
+    while (!free_agents.empty()) {
+      int a = free_agents.back();
+      int b = pref[(std::size_t)a * n_ + next[a]++];
+      int current = partner[b];
+      if (current == -1) {
+        partner[b] = a;
+        free_agents.pop_back();
+      } else if (rank[(std::size_t)b * n_ + a] < rank[(std::size_t)b * n_ + current]) {
+        partner[b] = a;
+        free_agents.back() = current;
+      }
+    }
+  }
+
+  // Men of rotation r move to the woman of the next man of the rotation.
+  void eliminate(int r, std::vector<int>& wife) const {
+    int first = rotation_start_[r], last = rotation_start_[r + 1];
+    for (int i = first; i < last; i++) {
+      wife[rotation_men_[i]] = rotation_women_[i + 1 == last ? first : i + 1];
+    }
+  }
+
+  void find_rotations() {
+    const int n = n_;
+    std::vector<int> wife = man_optimal_;
+    std::vector<int> husband(n);
+    for (int m = 0; m < n; m++) husband[wife[m]] = m;
+    std::vector<int> search(n);           // next position to look at
+    for (int m = 0; m < n; m++) search[m] = man_rank(m, wife[m]) + 1;
+    std::vector<char> on_stack(n, 0);
+    std::vector<int> stack;
+
+    rotation_start_.assign(1, 0);
+    rotation_men_.clear();
+    rotation_women_.clear();
+    weight_.clear();
+
+    for (int start = 0; start < n; start++) {
+      while (wife[start] != woman_optimal_[start]) {
+        if (stack.empty()) {
+          stack.push_back(start);
+          on_stack[start] = 1;
+        }
+
+        // s(m): first woman after his partner who prefers him to hers
+        int m = stack.back();
+        int& k = search[m];
+        while (k < n) {
+          int w = men_pref_[(std::size_t)m * n + k];
+          if (woman_rank(w, m) < woman_rank(w, husband[w])) break;
+          k++;
+        }
+        if (k == n) throw std::logic_error("rotation search ran past a preference list");
+        int next_man = husband[men_pref_[(std::size_t)m * n + k]];
+
+        if (!on_stack[next_man]) {
+          stack.push_back(next_man);
+          on_stack[next_man] = 1;
+          continue;
+        }
+
+        // The stack from next_man to the top is a rotation
+        std::size_t from = stack.size();
+        while (stack[from - 1] != next_man) from--;
+        from--;
+        long long weight = 0;
+        int size = (int)(stack.size() - from);
+        for (int i = 0; i < size; i++) {
+          int mi = stack[from + i];
+          int mj = stack[from + (i + 1) % size];
+          rotation_men_.push_back(mi);
+          rotation_women_.push_back(wife[mi]);
+          weight += man_rank(mi, wife[mj]) - man_rank(mi, wife[mi]);
+          weight += woman_rank(wife[mj], mi) - woman_rank(wife[mj], mj);
+        }
+        rotation_start_.push_back((int)rotation_men_.size());
+        weight_.push_back(weight);
+        eliminate(n_rotations() - 1, wife);
+        for (std::size_t i = from; i < stack.size(); i++) {
+          int mi = stack[i];
+          husband[wife[mi]] = mi;
+          search[mi] = man_rank(mi, wife[mi]) + 1;
+          on_stack[mi] = 0;
+        }
+        stack.resize(from);
+      }
+    }
+  }
+
+  void build_precedences() {
+    const int n = n_;
+    const int n_rot = n_rotations();
+
+    // Rotations of each man and of each woman in elimination order. The
+    // women list records the rotations that give her a new partner.
+    std::vector<int> man_count(n + 1, 0), woman_count(n + 1, 0);
+    for (int i = 0; i < (int)rotation_men_.size(); i++) {
+      man_count[rotation_men_[i] + 1]++;
+      woman_count[rotation_women_[i] + 1]++;
+    }
+    for (int a = 0; a < n; a++) {
+      man_count[a + 1] += man_count[a];
+      woman_count[a + 1] += woman_count[a];
+    }
+    std::vector<int> man_rotations(rotation_men_.size());
+    woman_rotations_.resize(rotation_women_.size());
+    woman_rotations_start_ = woman_count;
+    std::vector<int> man_fill(man_count.begin(), man_count.end() - 1);
+    std::vector<int> woman_fill(woman_count.begin(), woman_count.end() - 1);
+    for (int r = 0; r < n_rot; r++) {
+      for (int i = rotation_start_[r]; i < rotation_start_[r + 1]; i++) {
+        man_rotations[man_fill[rotation_men_[i]]++] = r;
+        woman_rotations_[woman_fill[rotation_women_[i]]++] = r;
+      }
+    }
+
+    // label[w * n + k]: the rotation after which w holds someone she ranks
+    // above position k, for the k strictly between two successive partners
+    std::vector<int> label((std::size_t)n * n, -1);
+    std::vector<int> wife = man_optimal_;
+    std::vector<int> husband(n);
+    for (int m = 0; m < n; m++) husband[wife[m]] = m;
+    for (int r = 0; r < n_rot; r++) {
+      int first = rotation_start_[r], last = rotation_start_[r + 1];
+      for (int i = first; i < last; i++) {
+        int w = rotation_women_[i];
+        int old_rank = woman_rank(w, rotation_men_[i]);
+        int new_man = rotation_men_[i == first ? last - 1 : i - 1];
+        int new_rank = woman_rank(w, new_man);
+        for (int k = new_rank + 1; k < old_rank; k++) label[(std::size_t)w * n + k] = r;
+      }
+    }
+
+    std::vector<std::pair<int, int>> edges;  // (rotation, predecessor)
+    for (int m = 0; m < n; m++) {
+      for (int i = man_count[m] + 1; i < man_count[m + 1]; i++) {
+        edges.push_back(std::make_pair(man_rotations[i], man_rotations[i - 1]));
+      }
+    }
+    for (int r = 0; r < n_rot; r++) {
+      int first = rotation_start_[r], last = rotation_start_[r + 1];
+      for (int i = first; i < last; i++) {
+        int m = rotation_men_[i];
+        int from = man_rank(m, rotation_women_[i]);
+        int to = man_rank(m, rotation_women_[i + 1 == last ? first : i + 1]);
+        for (int k = from + 1; k < to; k++) {
+          int w = men_pref_[(std::size_t)m * n + k];
+          int p = label[(std::size_t)w * n + woman_rank(w, m)];
+          if (p != -1 && p != r) edges.push_back(std::make_pair(r, p));
+        }
+      }
+    }
+
+    pred_start_.assign(n_rot + 1, 0);
+    for (auto& e : edges) pred_start_[e.first + 1]++;
+    for (int r = 0; r < n_rot; r++) pred_start_[r + 1] += pred_start_[r];
+    pred_.resize(edges.size());
+    std::vector<int> fill(pred_start_.begin(), pred_start_.end() - 1);
+    for (auto& e : edges) pred_[fill[e.first]++] = e.second;
+  }
+
+  int n_ = 0;
+  std::vector<int> men_pref_, women_pref_, men_rank_, women_rank_;
+  std::vector<int> man_optimal_, woman_optimal_;
+  // Rotation r lists the pairs (rotation_men_[i], rotation_women_[i]) for i
+  // in [rotation_start_[r], rotation_start_[r + 1]), in cycle order.
+  std::vector<int> rotation_start_, rotation_men_, rotation_women_;
+  std::vector<long long> weight_;
+  std::vector<int> woman_rotations_start_, woman_rotations_;
+  std::vector<int> pred_start_, pred_;
+};
+
+#endif
@@ -0,0 +1,121 @@
+// Small persistent thread pool shared by the parallel engines.
+//
+// The calling thread takes part in the work as thread 0, so a pool of size 1
+// starts no background thread and run() is a plain function call. Tasks must
+// not touch the R API: engines copy everything they need out of R objects
+// before going parallel.
+#ifndef CHT_WORKER_POOL_H
+#define CHT_WORKER_POOL_H
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkerPool {
+public:
+  explicit WorkerPool(int n_threads) {
+    n_threads = std::max(1, n_threads);
+    for (int t = 1; t < n_threads; t++) {
+      threads_.emplace_back([this, t] { worker_loop(t); });
+    }
+  }
+
+  ~WorkerPool() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& thread : threads_) thread.join();
+  }
+
+  WorkerPool(const WorkerPool&) = delete;
+  WorkerPool& operator=(const WorkerPool&) = delete;
+
+  int size() const { return (int)threads_.size() + 1; }
+
+  // Runs fn(thread_id) once on every thread and waits for all of them.
+  // The first exception thrown by a task is rethrown here.
+  void run(const std::function<void(int)>& fn) {
+    if (threads_.empty()) {
+      fn(0);
+      return;
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      task_ = &fn;
+      pending_ = (int)threads_.size();
+      error_ = nullptr;
+      generation_++;
+    }
+    wake_.notify_all();
+
+    try {
+      fn(0);
+    } catch (...) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!error_) error_ = std::current_exception();
+    }
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    done_.wait(lock, [this] { return pending_ == 0; });
+    task_ = nullptr;
+    if (error_) std::rethrow_exception(error_);
+  }
+
+  // Splits [0, n) into one contiguous chunk per thread and calls
+  // fn(begin, end, thread_id) on each non-empty chunk.
+  template <typename Fn>
+  void parallel_for(std::size_t n, Fn&& fn) {
+    const std::size_t n_chunks = size();
+    run([&](int t) {
+      std::size_t begin = n * t / n_chunks;
+      std::size_t end = n * (t + 1) / n_chunks;
+      if (begin < end) fn(begin, end, t);
+    });
+  }
+
+private:
+  void worker_loop(int t) {
+    unsigned long long seen = 0;
+    for (;;) {
+      const std::function<void(int)>* task;
+      {
+        std::unique_lock<std::mutex> lock(mutex_);
+        wake_.wait(lock, [&] { return stop_ || generation_ != seen; });
+        if (stop_) return;
+        seen = generation_;
+        task = task_;
+      }
+
+      try {
+        (*task)(t);
+      } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (!error_) error_ = std::current_exception();
+      }
+
+      {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (--pending_ == 0) done_.notify_one();
+      }
+    }
+  }
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable wake_;
+  std::condition_variable done_;
+  const std::function<void(int)>* task_ = nullptr;
+  unsigned long long generation_ = 0;
+  int pending_ = 0;
+  bool stop_ = false;
+  std::exception_ptr error_;
+};
+
+#endif